@@ -10,7 +10,12 @@
 #define _CIRCULAR_BUFFER_HPP
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
 #include "../Controllers/Common/Compiler/Compiler.h"
+#include "Span.hpp"
 
 /*!
   @file
@@ -22,13 +27,52 @@
 */
 namespace container{
 
+/*!
+  @brief Behaviour of buffer on overflow
+*/
+enum class overflow : uint8_t{
+  /*! @brief Oldest elements are overwritten by new ones*/
+  Overwrite,
+  /*! @brief New elements are dropped, if all of them don't fit*/
+  Drop,
+  /*! @brief New elements are accepted till buffer is full, the rest are dropped*/
+  Partial
+};
+
+/*!
+  @brief Storage of buffer's elements and indexes
+*/
+enum class storage : uint8_t{
+  /*! @brief Volatile elements. Safe for access from ISR and DMA*/
+  Volatile,
+  /*! @brief Plain elements. For buffer used from one context only. Allows vectorization and memcpy*/
+  Plain,
+  /*! @brief Plain elements and atomic indexes. For one writer and one reader in different contexts*/
+  Atomic
+};
+
 /*!
   @brief Class of Circular Buffer
   @tparam <T> buffer's type
   @tparam <size> number of elements in buffer
+  @tparam <policy> behaviour on overflow
+  @tparam <memory> storage of elements and indexes. 
+    With atomic storage writer should use Push, Fill, ReserveWrite, CommitWrite, policy should be Drop or Partial
+    (overwrite moves head, that is owned by reader), reader should use Pop, Front, PeekRead, ConsumeRead, AddToHead.
+    With volatile storage elements are read by value and spans of ReserveWrite, PeekRead are volatile
 */ 
-template<typename T, size_t size>
+template<typename T, size_t size, overflow policy = overflow::Overwrite, storage memory = storage::Volatile>
 class CircularBuffer{
+
+  static_assert(memory != storage::Atomic || policy != overflow::Overwrite, 
+                "Atomic storage requires Drop or Partial policy: writer can't move head of reader");
+  static_assert(memory != storage::Atomic || std::atomic<size_t>::is_always_lock_free,
+                "Atomic storage requires lock free indexes: lock could be taken by preempted context");
+
+  using pop_t = std::conditional_t<memory == storage::Plain, const T&, T>;
+  using front_t = std::conditional_t<memory == storage::Volatile, T, const T&>;
+  using element_t = std::conditional_t<memory == storage::Volatile, volatile T, T>;
+
 public:
 
   /*!
@@ -37,15 +81,21 @@ public:
   __FORCE_INLINE bool IsEmpty() const{ return  !static_cast<bool>(count); }
 
   /*!
-    @brief Pop the head element of buffer
+    @brief Pop the head element of buffer. 
+      With atomic storage element is returned by value, so writer can't overwrite it.
+      With volatile storage element is returned by value, so it is read as volatile.
+      Empty buffer returns front value, with atomic storage - default value: slot could be written by writer
   */
-  const T& Pop(){
-    auto currentHead = head;
-    if (count){
-      count--;
-      head = _IncrementValue(head);
+  pop_t Pop(){
+    size_t currentHead = head;
+    if (!count){
+      if constexpr (memory == storage::Atomic) return T{};
+      else return buffer[currentHead];
     }
-    return const_cast<const T&>(buffer[currentHead]);
+    pop_t element = buffer[currentHead];
+    head = _IncrementValue(currentHead);
+    count--;
+    return element;
   }
 
   /*!
@@ -55,31 +105,46 @@ public:
     @return number of poped elements
   */
   size_t Pop(T* destination, size_t length){
-    auto currentHead = head;
     if (length > count) length = count;
-    count -= length;
-    head = _AddValue(head, length);
-    for (size_t i = 0; i < length; ++i){
-      if (currentHead >= size) currentHead = 0;
-      destination[i] = buffer[currentHead++];
+    if (length == 1){
+        // Single element: no segments and loop setup
+      size_t currentHead = head;
+      *destination = buffer[currentHead];
+      head = _IncrementValue(currentHead);
+      count--;
+      return 1;
+    }
+    if (_IsBulk(length)){
+      size_t countFirst = size - head;
+      if (countFirst > length) countFirst = length;
+      _CopyFrom(destination, head, countFirst);
+      _CopyFrom(destination + countFirst, 0, length - countFirst);
+    } else {
+      size_t currentHead = head;
+      for (size_t i = 0; i < length; ++i){
+        destination[i] = buffer[currentHead];
+        currentHead = _IncrementValue(currentHead);
+      }
     }
+    head = _AddValue(head, length);
+    count -= length;
     return length;
   }
 
   /*!
     @brief Read the head element of buffer
   */
-  __FORCE_INLINE const T& Front() const { return (const T&)buffer[head]; }
+  __FORCE_INLINE front_t Front() const { return buffer[head]; }
 
   /*!
     @brief Fill the whole buffer with element
     @param [in] element to fill
   */
   void Fill(const T& element){
-    for (size_t i = 0; i < size; i++)
-      buffer[i] = element;
+    _Fill(0, element, size);
     head = tail = 0;
     count = size;
+    highWater = size;
   }
 
   /*!
@@ -87,15 +152,14 @@ public:
     @param [in] element to fill
   */
   void Fill(const T& element, size_t number){
-    number = number > size ? size : number;
-    for (size_t i = 0; i < number; i++){
-      buffer[tail] = element;
-      tail = _IncrementValue(tail);
-    }
-    if ((count + number) > size){
-      head = tail;
-      count = size;
-    } else count += number;
+    size_t skip;
+    number = _Admit(number, skip);
+    size_t countFirst = size - tail;
+    if (countFirst > number) countFirst = number;
+    _Fill(tail, element, countFirst);
+    _Fill(0, element, number - countFirst);
+    tail = _AddValue(tail, number);
+    _Admitted(number);
   }
 
   /*!
@@ -104,13 +168,18 @@ public:
     @return if false, then buffer was overflowed
   */
   bool Push(const T &element){
-    buffer[tail] = element;
-    tail = _IncrementValue(tail);
     if (count < size){
-      count++;
+      buffer[tail] = element;
+      tail = _IncrementValue(tail);
+      if (++count > highWater) highWater = count;
       return true;
-    } 
-    head = tail;
+    }
+    dropped++;
+    if constexpr (policy == overflow::Overwrite){
+      buffer[tail] = element;
+      tail = _IncrementValue(tail);
+      head = static_cast<size_t>(tail);
+    }
     return false;
   }
 
@@ -121,29 +190,35 @@ public:
     @return if false, then buffer was overflowed
   */
   bool Push(const T* elements, size_t length){
-    size_t index = length > size ? length - size : 0;
-
-    for (; index < length; ++index) {
-      buffer[tail] = elements[index];
-      tail = _IncrementValue(tail);
+    if (length == 1) return Push(*elements);
+    bool isFit = length <= size - count;
+    size_t index;
+    size_t number = _Admit(length, index);
+    if (_IsBulk(number)){
+      size_t countFirst = size - tail;
+      if (countFirst > number) countFirst = number;
+      _CopyTo(tail, elements + index, countFirst);
+      _CopyTo(0, elements + index + countFirst, number - countFirst);
+      tail = _AddValue(tail, number);
+    } else {
+      size_t currentTail = tail;
+      for (size_t i = 0; i < number; ++i) {
+        buffer[currentTail] = elements[index + i];
+        currentTail = _IncrementValue(currentTail);
+      }
+      tail = currentTail;
     }
-    
-    count += length;
-    if (count > size) {
-      count = size;
-      head = tail;
-      return true;
-    } 
-    return false;
+    _Admitted(number);
+    return isFit;
   }
 
   /*!
     @brief Read element of buffer
     @param [in] index of element in buffer
   */
-  __FORCE_INLINE const T& operator[](size_t index){
-    index = _AddValue(head + index);
-    return const_cast<const T&>(buffer[index]);
+  __FORCE_INLINE front_t operator[](size_t index){
+    index = _AddValue(head, index);
+    return buffer[index];
   }
 
   /*!
@@ -180,28 +255,35 @@ public:
     @brief Set buffer's head to last index(tail or 0)
   */
   void SetHeadToLastIndex(){
-    if (head >= tail) {
-      count += head - size;
+    size_t currentHead = head;
+    size_t currentTail = tail;
+    if (currentHead >= currentTail) {
       head = 0;
+      count -= size - currentHead;
     }
     else {
-      head = tail;
-      count = 0;
+      head = currentTail;
+      count -= currentTail - currentHead;
     }
   }
 
   /*!
     @brief Set buffer's head to tail
   */
-  void SetHeadToTailIndex(){ head = tail; }
+  void SetHeadToTailIndex(){ head = static_cast<size_t>(tail); }
 
   /*!
-    @brief Add value to tail index
+    @brief Add value to tail index. Elements are already written(e.g. by DMA),
+      so oldest ones are overwritten on overflow regardless of policy
   */
   void AddToTail(size_t valueToAdd){
     tail = _AddValue(tail, valueToAdd);
-    count = (count + valueToAdd) > size ? size : (count + valueToAdd);
-    if (!GetCountToOverflow()) head = tail;
+    if ((count + valueToAdd) > size){
+      dropped += count + valueToAdd - size;
+      count = size;
+    } else count += valueToAdd;
+    if (count > highWater) highWater = count;
+    if (!GetCountToOverflow()) head = static_cast<size_t>(tail);
   }
 
   /*!
@@ -209,7 +291,8 @@ public:
   */
   void AddToHead(size_t valueToAdd){
     head = _AddValue(head, valueToAdd);
-    count = (valueToAdd >= count) ? 0 : (count - valueToAdd);
+    size_t currentCount = count;
+    count -= (valueToAdd >= currentCount) ? currentCount : valueToAdd;
   }
 
   /*!
@@ -222,12 +305,125 @@ public:
   */
   __FORCE_INLINE const auto GetTailAddress(){ return &buffer[tail]; }
 
+  /*!
+    @brief Reserve free space for writing in place(e.g. by DMA or parser). 
+      Data becomes readable after CommitWrite
+    @param [in] length desired number of elements
+    @return up to two contiguous spans from tail. Limited by free space of buffer. Volatile for volatile storage
+  */
+  Spans<element_t> ReserveWrite(size_t length){
+    size_t free = size - count;
+    if (length > free) length = free;
+    size_t countFirst = size - tail;
+    if (countFirst > length) countFirst = length;
+    return Spans<element_t>{{buffer + tail, countFirst}, {buffer, length - countFirst}};
+  }
+
+  /*!
+    @brief Commit elements written in place after ReserveWrite
+    @param [in] length number of written elements. Limited by free space of buffer
+  */
+  void CommitWrite(size_t length){
+    size_t free = size - count;
+    if (length > free) length = free;
+    tail = _AddValue(tail, length);
+    count += length;
+    if (count > highWater) highWater = count;
+  }
+
+  /*!
+    @brief Get readable elements in place without copying. 
+      Elements stay in buffer till ConsumeRead
+    @return up to two contiguous spans from head. Volatile for volatile storage
+  */
+  Spans<const element_t> PeekRead(){
+    size_t countFirst = size - head;
+    if (countFirst > count) countFirst = count;
+    return Spans<const element_t>{{buffer + head, countFirst}, {buffer, count - countFirst}};
+  }
+
+  /*!
+    @brief Drop elements read in place after PeekRead
+    @param [in] length number of read elements. Limited by number of elements in buffer
+  */
+  void ConsumeRead(size_t length){
+    if (length > count) length = count;
+    head = _AddValue(head, length);
+    count -= length;
+  }
+
+  /*!
+    @brief Get number of elements dropped or overwritten on overflow since ResetStatistics
+  */
+  __FORCE_INLINE size_t GetDropped() const { return dropped; }
+
+  /*!
+    @brief Get max number of elements in buffer since ResetStatistics
+  */
+  __FORCE_INLINE size_t GetHighWater() const { return highWater; }
+
+  /*!
+    @brief Reset counter of dropped elements and high-water mark
+  */
+  __FORCE_INLINE void ResetStatistics(){
+    dropped = 0;
+    highWater = count;
+  }
+
 private:
 
-  size_t head = 0;
-  size_t tail = 0;
-  size_t count = 0;
-  volatile T buffer[size] {};
+    // Index with acquire loads and release stores. Count is changed by read-modify-write
+  struct _AtomicIndex{
+    std::atomic<size_t> value;
+    _AtomicIndex(size_t value): value(value){}
+    __FORCE_INLINE operator size_t() const { return value.load(std::memory_order_acquire); }
+    __FORCE_INLINE size_t operator=(size_t newValue){
+      value.store(newValue, std::memory_order_release);
+      return newValue;
+    }
+    __FORCE_INLINE size_t operator+=(size_t add){ return value.fetch_add(add, std::memory_order_acq_rel) + add; }
+    __FORCE_INLINE size_t operator-=(size_t sub){ return value.fetch_sub(sub, std::memory_order_acq_rel) - sub; }
+    __FORCE_INLINE size_t operator++(){ return *this += 1; }
+    __FORCE_INLINE size_t operator--(int){ return value.fetch_sub(1, std::memory_order_acq_rel); }
+  };
+
+  using index_t = std::conditional_t<memory == storage::Atomic, _AtomicIndex, size_t>;
+
+  index_t head = 0;
+  index_t tail = 0;
+  index_t count = 0;
+  size_t dropped = 0;
+  size_t highWater = 0;
+  element_t buffer[size] {};
+
+    // Number of elements to write according to policy. 
+    // Skip - number of oldest source elements, that are not written
+  __FORCE_INLINE size_t _Admit(size_t length, size_t& skip){
+    size_t free = size - count;
+    skip = 0;
+    if (length <= free) return length;
+    if constexpr (policy == overflow::Drop){
+      dropped += length;
+      return 0;
+    } else if constexpr (policy == overflow::Partial){
+      dropped += length - free;
+      return free;
+    } else {
+      dropped += length - free;
+      if (length > size) skip = length - size;
+      return length - skip;
+    }
+  }
+
+    // Account written elements. Oldest ones are overwritten, if buffer was overflowed
+  __FORCE_INLINE void _Admitted(size_t number){
+    count += number;
+    if (count > size){
+      count = size;
+      head = static_cast<size_t>(tail);
+    }
+    if (count > highWater) highWater = count;
+  }
   
   __FORCE_INLINE size_t _IncrementValue(size_t value){
     if constexpr ((size & (size - 1)) == 0) 
@@ -236,6 +432,44 @@ private:
       return ((value + 1) >= size) ? 0 : (value + 1);
   }
 
+    // Short transfers are copied element by element, long ones - by contiguous segments
+  __FORCE_INLINE static bool _IsBulk(size_t length){
+    return std::is_trivially_copyable_v<T> && length*sizeof(T) >= sizeBulkMin;
+  }
+
+    // Volatile elements are copied one by one: memcpy doesn't keep volatile accesses
+  static constexpr bool isMemcpy = memory != storage::Volatile && std::is_trivially_copyable_v<T>;
+
+    // Copy of contiguous segment to buffer
+  __FORCE_INLINE void _CopyTo(size_t index, const T* source, size_t length){
+    if constexpr (isMemcpy){
+      if (length) memcpy(&buffer[index], source, length*sizeof(T));
+    } else {
+      for (size_t i = 0; i < length; ++i)
+        buffer[index + i] = source[i];
+    }
+  }
+
+    // Copy of contiguous segment from buffer
+  __FORCE_INLINE void _CopyFrom(T* destination, size_t index, size_t length){
+    if constexpr (isMemcpy){
+      if (length) memcpy(destination, &buffer[index], length*sizeof(T));
+    } else {
+      for (size_t i = 0; i < length; ++i)
+        destination[i] = buffer[index + i];
+    }
+  }
+
+    // Fill of contiguous segment
+  __FORCE_INLINE void _Fill(size_t index, const T& element, size_t length){
+    auto data = &buffer[index];
+    T value = element;
+    for (size_t i = 0; i < length; ++i)
+      data[i] = value;
+  }
+
+  static constexpr size_t sizeBulkMin = 16;
+
   __FORCE_INLINE size_t _AddValue(size_t value, size_t add){
     if constexpr ((size & (size - 1)) == 0) 
       return (value + add) & (size - 1);
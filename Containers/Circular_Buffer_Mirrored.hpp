@@ -0,0 +1,269 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Circular buffer with contiguous view of data from head
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _CIRCULAR_BUFFER_MIRRORED_HPP
+#define _CIRCULAR_BUFFER_MIRRORED_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include "../Controllers/Common/Compiler/Compiler.h"
+#include "Span.hpp"
+
+#if defined(CIRCULAR_BUFFER_MIRROR_MMAP) && defined(__linux__)
+  #include <sys/mman.h>
+  #include <unistd.h>
+  #define _CIRCULAR_BUFFER_MIRROR_MMAP
+#endif
+
+/*!
+  @file
+  @brief Circular buffer with contiguous view of data from head
+*/
+
+/*!
+  @brief Namespace for data containers
+*/
+namespace container{
+
+/*!
+  @brief Class of Mirrored Circular Buffer. Data from head always looks contiguous,
+    so parsers make single linear scan without handling of wrap point.
+    Start of buffer is mirrored after its end: shadow copy is updated on each write.
+    On linux host, if CIRCULAR_BUFFER_MIRROR_MMAP is defined, the same memory is mapped twice instead
+    (size*sizeof(T) should be multiple of page size, otherwise shadow copy is used).
+    Oldest data is overwritten on overflow, as in CircularBuffer
+  @tparam <T> buffer's type. Should be trivially copyable
+  @tparam <size> number of elements in buffer
+  @tparam <sizeMirror> number of mirrored elements: max length of contiguous view over the wrap point
+*/
+template<typename T, size_t size, size_t sizeMirror = size>
+class CircularBufferMirrored{
+
+  static_assert(std::is_trivially_copyable_v<T>, "Type of mirrored buffer should be trivially copyable");
+  static_assert(sizeMirror && sizeMirror <= size, "Mirror should be in range [1, size]");
+
+public:
+
+  CircularBufferMirrored(){
+#if defined(_CIRCULAR_BUFFER_MIRROR_MMAP)
+    _Map();
+#endif
+  }
+
+  ~CircularBufferMirrored(){
+#if defined(_CIRCULAR_BUFFER_MIRROR_MMAP)
+    if (data != storage) munmap(data, 2*sizeof(T)*size);
+#endif
+  }
+
+  CircularBufferMirrored(const CircularBufferMirrored&) = delete;
+  CircularBufferMirrored& operator=(const CircularBufferMirrored&) = delete;
+
+  /*!
+    @brief Check the emptyness of buffer
+  */
+  __FORCE_INLINE bool IsEmpty() const{ return !count; }
+
+  /*!
+    @brief Pop the head element of buffer
+  */
+  const T& Pop(){
+    auto currentHead = head;
+    if (count){
+      count--;
+      head = _AddValue(head, 1);
+    }
+    return data[currentHead];
+  }
+
+  /*!
+    @brief Pop the elements to destination array
+    @param [out] destination pointer to output array
+    @param [in] length number of elements to pop
+    @return number of poped elements
+  */
+  size_t Pop(T* destination, size_t length){
+    if (length > count) length = count;
+      // View is limited by mirror, so elements after the wrap point are copied from the start of buffer
+    size_t countFirst = size - head;
+    if (countFirst > length) countFirst = length;
+    memcpy(destination, data + head, countFirst*sizeof(T));
+    memcpy(destination + countFirst, data, (length - countFirst)*sizeof(T));
+    ConsumeRead(length);
+    return length;
+  }
+
+  /*!
+    @brief Read the head element of buffer
+  */
+  __FORCE_INLINE const T& Front() const { return data[head]; }
+
+  /*!
+    @brief Push element to buffer
+    @param [in] element to push
+    @return if false, then buffer was overflowed
+  */
+  bool Push(const T &element){
+    data[tail] = element;
+    _Mirror(tail, 1);
+    return _AddToTail(1);
+  }
+
+  /*!
+    @brief Push array of elements to buffer
+    @param [in] pointer to array of elements
+    @param [in] number of elements to push
+    @return if false, then buffer was overflowed
+  */
+  bool Push(const T* elements, size_t length){
+    bool isOverflow = length > size;
+    if (isOverflow){
+      elements += length - size;
+      length = size;
+    }
+    size_t countFirst = size - tail;
+    if (countFirst > length) countFirst = length;
+    memcpy(data + tail, elements, countFirst*sizeof(T));
+    memcpy(data, elements + countFirst, (length - countFirst)*sizeof(T));
+    _Mirror(tail, countFirst);
+    _Mirror(0, length - countFirst);
+    return _AddToTail(length) && !isOverflow;
+  }
+
+  /*!
+    @brief Reserve free space for writing in place. Data becomes readable after CommitWrite
+    @param [in] length desired number of elements
+    @return up to two contiguous spans from tail. Limited by free space of buffer
+  */
+  Spans<T> ReserveWrite(size_t length){
+    size_t free = size - count;
+    if (length > free) length = free;
+    size_t countFirst = size - tail;
+    if (countFirst > length) countFirst = length;
+    return Spans<T>{{data + tail, countFirst}, {data, length - countFirst}};
+  }
+
+  /*!
+    @brief Commit elements written in place after ReserveWrite. Updates mirror
+    @param [in] length number of written elements. Limited by free space of buffer
+  */
+  void CommitWrite(size_t length){
+    size_t free = size - count;
+    if (length > free) length = free;
+    size_t countFirst = size - tail;
+    if (countFirst > length) countFirst = length;
+    _Mirror(tail, countFirst);
+    _Mirror(0, length - countFirst);
+    _AddToTail(length);
+  }
+
+  /*!
+    @brief Get contiguous view of data from head.
+      Over the wrap point view is limited by sizeMirror
+  */
+  __FORCE_INLINE Span<const T> PeekRead() const {
+    size_t countView = size - head + (data == storage ? sizeMirror : size);
+    return Span<const T>{data + head, count > countView ? countView : count};
+  }
+
+  /*!
+    @brief Drop elements read in place after PeekRead
+    @param [in] length number of read elements. Limited by number of elements in buffer
+  */
+  void ConsumeRead(size_t length){
+    if (length > count) length = count;
+    head = _AddValue(head, length);
+    count -= length;
+  }
+
+  /*!
+    @brief Read element of buffer
+    @param [in] index of element from head
+  */
+  __FORCE_INLINE const T& operator[](size_t index) const { return data[_AddValue(head, index)]; }
+
+  /*!
+    @brief Get size of buffer
+  */
+  __FORCE_INLINE size_t GetSize() const { return size; }
+
+  /*!
+    @brief Get current number of elements in buffer
+  */
+  __FORCE_INLINE size_t GetCount() const { return count; }
+
+  /*!
+    @brief Get the number of elements till buffer will be overflowed
+  */
+  __FORCE_INLINE size_t GetCountToOverflow() const { return size - count; }
+
+  /*!
+    @brief Flush buffer
+  */
+  __FORCE_INLINE void Flush(){ head = tail = count = 0; }
+
+private:
+
+  size_t head = 0;
+  size_t tail = 0;
+  size_t count = 0;
+  T storage[size + sizeMirror] {};
+  T* data = storage;
+
+    // Copy written elements from the start of buffer to the mirror
+  __FORCE_INLINE void _Mirror(size_t index, size_t length){
+    if (data != storage || index >= sizeMirror) return;
+    if (index + length > sizeMirror) length = sizeMirror - index;
+    memcpy(storage + size + index, storage + index, length*sizeof(T));
+  }
+
+  __FORCE_INLINE bool _AddToTail(size_t length){
+    tail = _AddValue(tail, length);
+    count += length;
+    if (count > size){
+      count = size;
+      head = tail;
+      return false;
+    }
+    return true;
+  }
+
+  __FORCE_INLINE static size_t _AddValue(size_t value, size_t add){
+    if constexpr ((size & (size - 1)) == 0)
+      return (value + add) & (size - 1);
+    else
+      return (value + add) % size;
+  }
+
+#if defined(_CIRCULAR_BUFFER_MIRROR_MMAP)
+    // Map one memory block twice: [0, size) and [size, 2*size) are the same elements
+  void _Map(){
+    size_t sizeBytes = sizeof(T)*size;
+    if (sizeBytes % static_cast<size_t>(sysconf(_SC_PAGESIZE))) return;
+    int fd = memfd_create("CircularBufferMirrored", 0);
+    if (fd < 0) return;
+    void* base = MAP_FAILED;
+    if (!ftruncate(fd, sizeBytes))
+      base = mmap(nullptr, 2*sizeBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED){
+      auto first = mmap(base, sizeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+      auto second = mmap(static_cast<char*>(base) + sizeBytes, sizeBytes, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_FIXED, fd, 0);
+      if (first == MAP_FAILED || second == MAP_FAILED) munmap(base, 2*sizeBytes);
+      else data = static_cast<T*>(base);
+    }
+    close(fd);
+  }
+#endif
+
+};
+
+} //! namspace container
+
+#endif //!_CIRCULAR_BUFFER_MIRRORED_HPP
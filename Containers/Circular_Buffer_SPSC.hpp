@@ -0,0 +1,261 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Lock-free single-producer/single-consumer circular buffer
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _CIRCULAR_BUFFER_SPSC_HPP
+#define _CIRCULAR_BUFFER_SPSC_HPP
+
+#include <cstddef>
+#include <atomic>
+#include "../Controllers/Common/Compiler/Compiler.h"
+#include "Span.hpp"
+
+/*!
+  @file
+  @brief Lock-free single-producer/single-consumer circular buffer
+*/
+
+/*!
+  @brief Namespace for data containers
+*/
+namespace container{
+
+/*!
+  @brief Class of lock-free Circular Buffer for one producer(e.g. ISR) and one consumer(e.g. main loop).
+    Producer owns tail, consumer owns head. Both are free-running counters,
+    so no shared count and no interrupts masking are needed.
+    Buffer never overwrites data: Push is rejected, when buffer is full.
+    Producer's methods: Push, Fill, AddToTail, GetTailAddress, GetCountToBuffersEnd, GetCountToOverflow.
+    Consumer's methods: Pop, Front, operator[], AddToHead, GetHeadAddress, GetCountToBufferLastIndex, Flush.
+  @tparam <T> buffer's type
+  @tparam <size> number of elements in buffer. Should be power of 2
+*/
+template<typename T, size_t size>
+class CircularBufferSPSC{
+
+  static_assert(size && !(size & (size - 1)), "Size of SPSC buffer should be power of 2");
+
+public:
+
+  /*!
+    @brief Check the emptyness of buffer
+  */
+  __FORCE_INLINE bool IsEmpty() const{
+    return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+  }
+
+  /*!
+    @brief Pop the head element of buffer. Consumer
+    @return head element. If buffer is empty - T{}, so check IsEmpty before, if T{} is valid data.
+      Slot of the last poped element isn't read: producer may write it
+  */
+  T Pop(){
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire))
+      return T{};
+    T element = buffer[currentHead & mask];
+    head.store(currentHead + 1, std::memory_order_release);
+    return element;
+  }
+
+  /*!
+    @brief Pop the elements to destination array. Consumer
+    @param [out] destination pointer to output array
+    @param [in] length number of elements to pop
+    @return number of poped elements
+  */
+  size_t Pop(T* destination, size_t length){
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    size_t count = tail.load(std::memory_order_acquire) - currentHead;
+    if (length > count) length = count;
+    for (size_t i = 0; i < length; ++i)
+      destination[i] = buffer[(currentHead + i) & mask];
+    head.store(currentHead + length, std::memory_order_release);
+    return length;
+  }
+
+  /*!
+    @brief Read the head element of buffer. Consumer
+  */
+  __FORCE_INLINE T Front() const { return buffer[head.load(std::memory_order_relaxed) & mask]; }
+
+  /*!
+    @brief Push element to buffer. Producer
+    @param [in] element to push
+    @return if false, then buffer was overflowed and element is dropped
+  */
+  bool Push(const T &element){
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail - head.load(std::memory_order_acquire) >= size)
+      return false;
+    buffer[currentTail & mask] = element;
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*!
+    @brief Push array of elements to buffer. Producer
+    @param [in] pointer to array of elements
+    @param [in] number of elements to push
+    @return if false, then buffer was overflowed and rest of elements are dropped
+  */
+  bool Push(const T* elements, size_t length){
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    size_t free = size - (currentTail - head.load(std::memory_order_acquire));
+    size_t count = length > free ? free : length;
+    for (size_t i = 0; i < count; ++i)
+      buffer[(currentTail + i) & mask] = elements[i];
+    tail.store(currentTail + count, std::memory_order_release);
+    return count == length;
+  }
+
+  /*!
+    @brief Push element to buffer number of times. Producer
+    @param [in] element to fill
+    @param [in] number of elements
+    @return if false, then buffer was overflowed
+  */
+  bool Fill(const T& element, size_t number){
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    size_t free = size - (currentTail - head.load(std::memory_order_acquire));
+    size_t count = number > free ? free : number;
+    for (size_t i = 0; i < count; ++i)
+      buffer[(currentTail + i) & mask] = element;
+    tail.store(currentTail + count, std::memory_order_release);
+    return count == number;
+  }
+
+  /*!
+    @brief Read element of buffer. Consumer
+    @param [in] index of element from head
+  */
+  __FORCE_INLINE T operator[](size_t index) const {
+    return buffer[(head.load(std::memory_order_relaxed) + index) & mask];
+  }
+
+  /*!
+    @brief Get size of buffer
+  */
+  __FORCE_INLINE size_t GetSize() const { return size; }
+
+  /*!
+    @brief Get current number of elements in buffer
+  */
+  __FORCE_INLINE size_t GetCount() const {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+  }
+
+  /*!
+    @brief Get the number of elements till buffer will be overflowed. Producer
+  */
+  __FORCE_INLINE size_t GetCountToOverflow() const {
+    return size - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+  }
+
+  /*!
+    @brief Flush buffer: drop all written elements. Consumer
+  */
+  __FORCE_INLINE void Flush(){ head.store(tail.load(std::memory_order_acquire), std::memory_order_release); }
+
+  /*!
+    @brief Get the number of contiguous elements from head till tail or end of the buffer. Consumer
+  */
+  __FORCE_INLINE size_t GetCountToBufferLastIndex() const {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    size_t count = tail.load(std::memory_order_acquire) - currentHead;
+    size_t countToEnd = size - (currentHead & mask);
+    return count > countToEnd ? countToEnd : count;
+  }
+
+  /*!
+    @brief Get the difference between size of buffer and current tail index. Producer
+  */
+  __FORCE_INLINE size_t GetCountToBuffersEnd() const { return size - (tail.load(std::memory_order_relaxed) & mask); }
+
+  /*!
+    @brief Commit elements, written directly to tail address(e.g. by DMA). Producer
+    @param [in] valueToAdd number of elements. Limited by free space
+  */
+  void AddToTail(size_t valueToAdd){
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    size_t free = size - (currentTail - head.load(std::memory_order_acquire));
+    tail.store(currentTail + (valueToAdd > free ? free : valueToAdd), std::memory_order_release);
+  }
+
+  /*!
+    @brief Drop elements from head. Consumer
+    @param [in] valueToAdd number of elements. Limited by number of elements in buffer
+  */
+  void AddToHead(size_t valueToAdd){
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    size_t count = tail.load(std::memory_order_acquire) - currentHead;
+    head.store(currentHead + (valueToAdd > count ? count : valueToAdd), std::memory_order_release);
+  }
+
+  /*!
+    @brief Get address of buffer's head. Consumer
+  */
+  __FORCE_INLINE const T* GetHeadAddress() const { return &buffer[head.load(std::memory_order_relaxed) & mask]; }
+
+  /*!
+    @brief Get address of buffer's tail. Producer
+  */
+  __FORCE_INLINE T* GetTailAddress() { return &buffer[tail.load(std::memory_order_relaxed) & mask]; }
+
+  /*!
+    @brief Reserve free space for writing in place. Producer
+    @param [in] length desired number of elements
+    @return up to two contiguous spans from tail. Limited by free space of buffer
+  */
+  Spans<T> ReserveWrite(size_t length){
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    size_t free = size - (currentTail - head.load(std::memory_order_acquire));
+    if (length > free) length = free;
+    size_t index = currentTail & mask;
+    size_t countFirst = size - index;
+    if (countFirst > length) countFirst = length;
+    return Spans<T>{{&buffer[index], countFirst}, {buffer, length - countFirst}};
+  }
+
+  /*!
+    @brief Commit elements written in place after ReserveWrite. Producer
+    @param [in] length number of written elements. Limited by free space of buffer
+  */
+  __FORCE_INLINE void CommitWrite(size_t length){ AddToTail(length); }
+
+  /*!
+    @brief Get readable elements in place without copying. Consumer
+    @return up to two contiguous spans from head
+  */
+  Spans<const T> PeekRead() const {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    size_t count = tail.load(std::memory_order_acquire) - currentHead;
+    size_t index = currentHead & mask;
+    size_t countFirst = size - index;
+    if (countFirst > count) countFirst = count;
+    return Spans<const T>{{&buffer[index], countFirst}, {buffer, count - countFirst}};
+  }
+
+  /*!
+    @brief Drop elements read in place after PeekRead. Consumer
+    @param [in] length number of read elements. Limited by number of elements in buffer
+  */
+  __FORCE_INLINE void ConsumeRead(size_t length){ AddToHead(length); }
+
+private:
+
+  static constexpr size_t mask = size - 1;
+
+  std::atomic<size_t> head = 0;
+  std::atomic<size_t> tail = 0;
+  T buffer[size] {};
+
+};
+
+} //! namspace container
+
+#endif //!_CIRCULAR_BUFFER_SPSC_HPP
@@ -0,0 +1,96 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  View of contiguous elements
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _SPAN_HPP
+#define _SPAN_HPP
+
+#include <cstddef>
+#include "../Controllers/Common/Compiler/Compiler.h"
+
+/*!
+  @file
+  @brief View of contiguous elements
+*/
+
+/*!
+  @brief Namespace for data containers
+*/
+namespace container{
+
+/*!
+  @brief Non-owning view of contiguous elements
+  @tparam <T> type of elements
+*/
+template<typename T>
+struct Span{
+
+  /*! @brief Pointer to first element*/
+  T* data = nullptr;
+
+  /*! @brief Number of elements*/
+  size_t size = 0;
+
+  __FORCE_INLINE T* begin() const { return data; }
+  __FORCE_INLINE T* end() const { return data + size; }
+  __FORCE_INLINE T& operator[](size_t index) const { return data[index]; }
+
+  /*!
+    @brief Check the emptyness of span
+  */
+  __FORCE_INLINE bool IsEmpty() const { return !size; }
+
+};
+
+/*!
+  @brief Two views of circular buffer: till the end of buffer and from the start of buffer
+  @tparam <T> type of elements
+*/
+template<typename T>
+struct Spans{
+
+  /*! @brief Elements from index till the end of buffer*/
+  Span<T> first;
+
+  /*! @brief Wrapped elements from the start of buffer*/
+  Span<T> second;
+
+  /*!
+    @brief Get total number of elements
+  */
+  __FORCE_INLINE size_t GetSize() const { return first.size + second.size; }
+
+  /*!
+    @brief Check the emptyness of spans
+  */
+  __FORCE_INLINE bool IsEmpty() const { return !first.size; }
+
+  /*!
+    @brief Get element by index through both spans
+  */
+  __FORCE_INLINE T& operator[](size_t index) const {
+    return index < first.size ? first.data[index] : second.data[index - first.size];
+  }
+
+  /*!
+    @brief Get part of spans
+    @param [in] offset index of first element
+    @param [in] length number of elements. Should be in range of spans
+  */
+  __FORCE_INLINE Spans Slice(size_t offset, size_t length) const {
+    if (offset >= first.size)
+      return Spans{{second.data + offset - first.size, length}, {second.data, 0}};
+    size_t countFirst = first.size - offset;
+    if (countFirst > length) countFirst = length;
+    return Spans{{first.data + offset, countFirst}, {second.data, length - countFirst}};
+  }
+
+};
+
+} //! namspace container
+
+#endif //!_SPAN_HPP
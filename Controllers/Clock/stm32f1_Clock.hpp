@@ -17,6 +17,18 @@
 #include "../Pin/stm32f1_Pin.hpp"
 #include "../Pinlist/stm32f1_Pinlist.hpp"
 
+#ifndef CLOCK_VALUE
+  #define CLOCK_VALUE 72000000
+#endif
+
+#ifndef CLOCK_SOURCE
+  #define CLOCK_SOURCE configuration::clock::source::HSE
+#endif
+
+#ifndef CLOCK_SOURCE_VALUE
+  #define CLOCK_SOURCE_VALUE 8000000
+#endif
+
 /*!
   @brief Controller's peripherals devices
 */
@@ -59,6 +71,18 @@ class Clock: private hardware::Registers{
 
 public:
 
+  /*!
+    @brief Clock tree, computed at compile time. Frequencies of buses for the same parameters as in Set.
+      Default parameters are set by CLOCK_VALUE, CLOCK_SOURCE, CLOCK_SOURCE_VALUE
+    @tparam <value> value of system clock (in Hz)
+    @tparam <source> source of clock
+    @tparam <sourceValue> HSE value (in Hz). Skip it in case of HSI
+  */
+  template<uint32_t value = CLOCK_VALUE, 
+           configuration::clock::source source = CLOCK_SOURCE, 
+           uint32_t sourceValue = CLOCK_SOURCE_VALUE>
+  struct Tree;
+
   /*!
     @brief Set controller clock
     ADC-clock is set to value/2.
@@ -66,18 +90,22 @@ public:
     AHB-clock is set to value.
     APB1-clock is set to 36MHz in case of value\2 >= 36MHz, othervise to value.
     APB2-clock is set to value.
+    Peripherals configured at compile time(e.g.: BRR of UART) take clock tree as parameter, Tree<> by default.
+    If Set is called with parameters other than CLOCK_VALUE, CLOCK_SOURCE, CLOCK_SOURCE_VALUE,
+    pass Tree<value, source, sourceValue> to them
     @tparam <value> new value for system clock (in Hz)
     @tparam <source> if true, then controller is driven by external source(HSE), otherwise - by internal(HSI). Default value is HSE
     @tparam <sourceValue> HSE value (in Hz). Skip it in case of HSI
   */
-  template<uint32_t value = 72000000, 
-           configuration::clock::source source = configuration::clock::source::HSE, 
-           uint32_t sourceValue = 8000000>
+  template<uint32_t value = CLOCK_VALUE, 
+           configuration::clock::source source = CLOCK_SOURCE, 
+           uint32_t sourceValue = CLOCK_SOURCE_VALUE>
   static bool Set(){
     
     using namespace configuration::clock;
-    uint32_t constexpr valueSource = source == source::HSI ? 8000000 : sourceValue;
-    uint32_t constexpr valueCFGR = _GetValueCFGR<value, source, valueSource>();
+    using tree = Tree<value, source, sourceValue>;
+    uint32_t constexpr valueSource = tree::valueSource;
+    uint32_t constexpr valueCFGR = tree::valueCFGR;
     uint32_t constexpr valueFlagSource = source == source::HSE ? valueOnHSE : valueOnHSI;
     uint32_t constexpr valueFlagReady = source == source::HSE ? valueFlagReadyHSE : valueFlagReadyHSI;
     uint32_t constexpr valueFlagClearSource = source == source::HSE ? valueOnHSI : valueOnHSE;
@@ -97,14 +125,14 @@ public:
       if (!_IsValueSet<addressCFGR, valueSWS_PLL, valueMaskSWS>()) return false;
     }
 
-    valueSystem = value;
-    valueAHB = valueSystem; // !This value is correct, if RCC_CFGR_HPRE is set to default (SYSCLK not divided)
-    valueAPB1 = _GetValueAPB<valueCFGR, valueMaskPrescalerAPB1, startBitAPB1, 1>();
-    valueAPB1TIM = _GetValueAPB<valueCFGR, valueMaskPrescalerAPB1, startBitAPB1, 2>();
-    valueAPB2 = valueAHB;
-    valueAPB2TIM = valueAHB;
-    valueADC = valueAHB / valuePrescalerADC;
-    valueUSB = valuePrescalerUSB<value> ? valueAHB : (valueAHB * 2) / 3;
+    valueSystem = tree::valueSystem;
+    valueAHB = tree::valueAHB;
+    valueAPB1 = tree::valueAPB1;
+    valueAPB1TIM = tree::valueAPB1TIM;
+    valueAPB2 = tree::valueAPB2;
+    valueAPB2TIM = tree::valueAPB2TIM;
+    valueADC = tree::valueADC;
+    valueUSB = tree::valueUSB;
    
     return true;
   }
@@ -265,13 +293,13 @@ private:
   }
 
   template<uint32_t valueCFGR, uint32_t bitMask, uint32_t startBit, uint32_t mulTim>
-  static constexpr uint32_t _GetValueAPB(){
+  static constexpr uint32_t _GetValueAPB(uint32_t frequencyAHB){
     uint32_t prescallerAPB = (valueCFGR & bitMask) >> startBit;
     if (prescallerAPB >= valuePrescaler2APB){
       prescallerAPB &=~ valuePrescaler2APB;
-      return (valueAHB >> (prescallerAPB + 1)) * mulTim;
+      return (frequencyAHB >> (prescallerAPB + 1)) * mulTim;
     } else{
-      return valueAHB;
+      return frequencyAHB;
     }
   }
 
@@ -297,6 +325,20 @@ private:
 
 };
 
+template<uint32_t value, configuration::clock::source source, uint32_t sourceValue>
+struct Clock::Tree{
+  static constexpr uint32_t valueSource = source == configuration::clock::source::HSI ? 8000000 : sourceValue;
+  static constexpr uint32_t valueCFGR = _GetValueCFGR<value, source, valueSource>();
+  static constexpr uint32_t valueSystem = value;
+  static constexpr uint32_t valueAHB = valueSystem; // !This value is correct, if RCC_CFGR_HPRE is set to default (SYSCLK not divided)
+  static constexpr uint32_t valueAPB1 = _GetValueAPB<valueCFGR, valueMaskPrescalerAPB1, startBitAPB1, 1>(valueAHB);
+  static constexpr uint32_t valueAPB1TIM = _GetValueAPB<valueCFGR, valueMaskPrescalerAPB1, startBitAPB1, 2>(valueAHB);
+  static constexpr uint32_t valueAPB2 = valueAHB;
+  static constexpr uint32_t valueAPB2TIM = valueAHB;
+  static constexpr uint32_t valueADC = valueAHB / valuePrescalerADC;
+  static constexpr uint32_t valueUSB = valuePrescalerUSB<value> ? valueAHB : (valueAHB * 2) / 3;
+};
+
 } // !namespace controller
 
 #endif //!_STM32F1_CLOCK_HPP
\ No newline at end of file
@@ -0,0 +1,73 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Cycle counter of Data Watchpoint and Trace unit. Cortex-M3 and higher
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _DWT_HPP
+#define _DWT_HPP
+
+#include <cstdint>
+#include "../Compiler/Compiler.h"
+#include "Registers.hpp"
+
+/*!
+  @brief Controller's peripherals devices
+*/
+namespace controller
+{
+
+/*!
+  @brief Cycle counter of DWT. Free-running 32-bit counter of core cycles, used for timestamps
+*/
+class DWT: private hardware::Registers{
+public:
+
+  /*!
+    @brief Enable cycle counter
+  */
+  __FORCE_INLINE static void Enable(){
+    Registers::_Set<address::DEMCR, mask::DEMCR::TRCENA>();
+    Registers::_Set<address::CTRL, mask::CTRL::CYCCNTENA>();
+  }
+
+  /*!
+    @brief Disable cycle counter
+  */
+  __FORCE_INLINE static void Disable(){ Registers::_Clear<address::CTRL, mask::CTRL::CYCCNTENA>(); }
+
+  /*!
+    @brief Get number of core cycles. Difference of two values is valid, if less than 2^32 cycles
+  */
+  __FORCE_INLINE static uint32_t GetCycles(){ return Registers::_Read<address::CYCCNT>(); }
+
+private:
+
+  DWT() = delete;
+
+  struct address{
+    static constexpr uint32_t
+      base = 0xE0001000,
+      CTRL = base,
+      CYCCNT = base + 4,
+      DEMCR = 0xE000EDFC;
+  };
+
+  struct mask{
+    struct CTRL{
+      static constexpr uint32_t
+        CYCCNTENA = 1;
+    };
+    struct DEMCR{
+      static constexpr uint32_t
+        TRCENA = 1 << 24;
+    };
+  };
+
+};
+
+} // !namespace controller
+
+#endif // !_DWT_HPP
@@ -59,7 +59,8 @@ private:
       using listAddresses = valuelist_add_t<addressBase, valuelist_mul_t<4, listRegisters>>;
 
       __COMPILER_BARRIER();
-      Registers::_Set<listAddresses, listValues>();
+        // Writing 0 to ISER/ICER has no effect, so store is enough: no read-modify-write
+      Registers::_Write<listAddresses, listValues>();
       __COMPILER_BARRIER();
     }
   }
@@ -9,9 +9,20 @@
 #ifndef _REGISTERS_HPP
 #define _REGISTERS_HPP
 
+#include <utility>
+#include <algorithm>
 #include "../Compiler/Compiler.h"
+#include "../Controller_Define.hpp"
 #include "../../../Utils/type_traits_custom.hpp"
 
+#if defined(REGISTERS_SIMULATION)
+  #include "Registers_Simulation.hpp"
+#endif
+
+#if defined(REGISTERS_TRACE)
+  #include "Registers_Trace.hpp"
+#endif
+
 namespace controller::hardware{
 
 /*!
@@ -21,37 +32,257 @@ class Registers{
 
   Registers() = delete;
 
+#if defined(REGISTERS_TRACE)
+  using trace_access = trace::access;
+#else
+  enum class trace_access : uint8_t { Read, Write, ReadModifyWrite };
+#endif
+
   template<auto address, typename accessType = decltype(address)>
   static inline auto& reg = *reinterpret_cast<volatile accessType * const>(address);
 
+  /*!
+    @brief Read register on the bus: controller's memory or simulated address space
+    @tparam <address> address of register
+    @tparam <accessType> type of access to register
+  */
+  template<auto address, typename accessType = decltype(address)>
+  __FORCE_INLINE static accessType _BusRead(){
+#if defined(REGISTERS_SIMULATION)
+    return static_cast<accessType>(simulation::Memory::Read(static_cast<uint32_t>(address)));
+#else
+    return reg<address, accessType>;
+#endif
+  }
+
+  /*!
+    @brief Write register on the bus: controller's memory or simulated address space
+    @tparam <address> address of register
+    @tparam <accessType> type of access to register
+    @param [in] value to write
+  */
+  template<auto address, typename accessType = decltype(address)>
+  __FORCE_INLINE static void _BusWrite(accessType value){
+#if defined(REGISTERS_SIMULATION)
+    simulation::Memory::Write(static_cast<uint32_t>(address), static_cast<uint32_t>(value));
+#else
+    reg<address, accessType> = value;
+#endif
+  }
+
+  /*!
+    @brief Record access to register, if REGISTERS_TRACE is defined
+    @tparam <address> address of register
+  */
+  template<auto address>
+  __FORCE_INLINE static void _Trace([[maybe_unused]] trace_access access,
+                                    [[maybe_unused]] uint32_t value,
+                                    [[maybe_unused]] uint32_t mask){
+#if defined(REGISTERS_TRACE)
+    trace::Trace::Add(access, static_cast<uint32_t>(address), value, mask);
+#endif
+  }
+
+  /*!
+    @brief Load value of register. All plain reads of registers pass through it
+    @tparam <address> address of register
+    @tparam <accessType> type of access to register
+  */
+  template<auto address, typename accessType = decltype(address)>
+  __FORCE_INLINE static accessType _Load(){
+    accessType value = _BusRead<address, accessType>();
+    _Trace<address>(trace_access::Read, value, ~0U);
+    return value;
+  }
+
+  /*!
+    @brief Store value to register. All plain writes of registers pass through it
+    @tparam <address> address of register
+    @tparam <accessType> type of access to register
+    @param [in] value to store
+  */
+  template<auto address, typename accessType = decltype(address)>
+  __FORCE_INLINE static void _Store(accessType value){
+    _BusWrite<address, accessType>(value);
+    _Trace<address>(trace_access::Write, value, ~0U);
+  }
+
+  /*!
+    @brief Read, modify and write register. All read-modify-write sequences pass through it
+    @tparam <address> address of register
+    @param [in] value to set
+    @param [in] mask of bits to modify
+  */
+  template<auto address>
+  __FORCE_INLINE static void _Update(decltype(address) value, decltype(address) mask){
+    _BusWrite<address>((_BusRead<address>() &(~mask)) | value);
+    _Trace<address>(trace_access::ReadModifyWrite, value, mask);
+  }
+
+#if defined(CORTEX_M3) && !defined(REGISTERS_NO_BITBAND)
+  static constexpr bool isBitBandSupported = true;
+#else
+  static constexpr bool isBitBandSupported = false;
+#endif
+
+  static constexpr uint32_t _BitNumber(uint32_t mask){
+    uint32_t number = 0;
+    while (mask > 1) { mask >>= 1; ++number; }
+    return number;
+  }
+
+  /*!
+    @brief Check if single-bit access to register could be made via bit-band alias.
+      Cortex-M3 maps each bit of SRAM (0x20000000-0x200FFFFF) and 
+      peripherals (0x40000000-0x400FFFFF) to word in alias region
+    @tparam <address> address of register
+    @tparam <mask> mask of bit
+  */
+  template<auto address, auto mask>
+  static constexpr bool _IsBitBand = isBitBandSupported && sizeof(address) == sizeof(uint32_t) &&
+    static_cast<uint32_t>(mask) && !(static_cast<uint32_t>(mask) & (static_cast<uint32_t>(mask) - 1)) &&
+    ((static_cast<uint32_t>(address) >= 0x20000000 && static_cast<uint32_t>(address) < 0x20100000) ||
+     (static_cast<uint32_t>(address) >= 0x40000000 && static_cast<uint32_t>(address) < 0x40100000));
+
+  /*!
+    @brief Address of bit in bit-band alias region
+    @tparam <address> address of register
+    @tparam <mask> mask of bit
+  */
+  template<auto address, auto mask>
+  static constexpr uint32_t _BitBandAlias = (static_cast<uint32_t>(address) & 0xF0000000) + 0x02000000 +
+                                            ((static_cast<uint32_t>(address) & 0xFFFFF) << 5) +
+                                            (_BitNumber(static_cast<uint32_t>(mask)) << 2);
+
+  /*!
+    @brief Set or clear single bit of register with one store to bit-band alias. Atomic
+    @tparam <address> address of register
+    @tparam <mask> mask of bit
+    @param [in] isSet new state of bit
+  */
+  template<auto address, auto mask>
+  __FORCE_INLINE static void _BitStore(bool isSet){
+    _BusWrite<_BitBandAlias<address, mask>, uint32_t>(isSet ? 1U : 0U);
+    _Trace<address>(trace_access::Write, isSet ? static_cast<uint32_t>(mask) : 0U, static_cast<uint32_t>(mask));
+  }
+
+  /*!
+    @brief Read, modify and write register with constant value and mask.
+      Single-bit modification of bit-band region is made by bit-band alias.
+      Value with bits outside of mask is set by read-modify-write: (reg & ~mask) | value
+    @tparam <address> address of register
+    @tparam <value> to set
+    @tparam <mask> mask of bits to modify
+  */
+  template<auto address, auto value, auto mask>
+  __FORCE_INLINE static void _Update(){
+    if constexpr (_IsBitBand<address, mask> && !(static_cast<uint32_t>(value) & ~static_cast<uint32_t>(mask))) 
+      _BitStore<address, mask>(static_cast<uint32_t>(value) & static_cast<uint32_t>(mask));
+    else _Update<address>(value, mask);
+  }
+
+  /*!
+    @brief Table of coalesced accesses. Built at compile time
+    @tparam <T> type of registers values
+    @tparam <size> max number of accesses
+  */
+  template<typename T, size_t size>
+  struct _ModifyTable{
+    T address[size] {};
+    T value[size] {};
+    T mask[size] {};
+    bool isStore[size] {};
+    size_t count = 0;
+  };
+
+  template<bool isSet, typename AddressesList, typename ValueList, typename MaskList>
+  struct _Coalesce{
+    static constexpr size_t count = 0;
+  };
+
+  /*!
+    @brief Merge adjacent read-modify-write accesses to the same address. Program order is kept.
+      Full-mask accesses become plain stores, no-op accesses are dropped.
+      Stores are never merged, so repeated writes(e.g.: key sequence) reach register
+  */
+  template<bool isSet, auto addressFirst, auto... addresses, auto valueFirst, auto... values, 
+           auto maskFirst, auto... masks>
+  struct _Coalesce<isSet, trait::Valuelist<addressFirst, addresses...>, 
+                          trait::Valuelist<valueFirst, values...>, 
+                          trait::Valuelist<maskFirst, masks...>>{
+    using T = decltype(addressFirst);
+    static constexpr size_t size = 1 + std::min({sizeof...(addresses), sizeof...(values), sizeof...(masks)});
+
+    static constexpr auto _Build(){
+      constexpr T listAddresses[] = {addressFirst, static_cast<T>(addresses)...};
+      constexpr T listValues[] = {static_cast<T>(valueFirst), static_cast<T>(values)...};
+      constexpr T listMasks[] = {static_cast<T>(maskFirst), static_cast<T>(masks)...};
+      constexpr T maskFull = static_cast<T>(~T(0));
+      _ModifyTable<T, size> table {};
+
+      for (size_t i = 0; i < size; ++i){
+        T value = listValues[i], mask = listMasks[i];
+        if (!value && !mask) continue;
+        size_t j = table.count;
+          // Write: reg = mask & value
+        if (!isSet){
+          table.address[j] = listAddresses[i];
+          table.value[j] = mask & value;
+          table.mask[j] = maskFull;
+          table.isStore[j] = true;
+          table.count++;
+          continue;
+        }
+          // Set: reg = (reg & ~mask) | value
+        T set = value;
+        T clear = mask & ~value;
+        bool isMerged = j && table.address[j - 1] == listAddresses[i] && 
+                        !table.isStore[j - 1] && (set | clear) != maskFull;
+        if (isMerged){
+          --j;
+          T setPrevious = table.value[j];
+          T clearPrevious = table.mask[j] & ~setPrevious;
+          T setMerged = (setPrevious & ~clear) | set;
+          clear = (clearPrevious & ~set) | clear;
+          set = setMerged;
+        } else table.count++;
+        table.address[j] = listAddresses[i];
+        table.value[j] = set;
+        table.mask[j] = set | clear;
+        table.isStore[j] = table.mask[j] == maskFull;
+      }
+      return table;
+    }
+
+    static constexpr auto table = _Build();
+    static constexpr size_t count = table.count;
+  };
+
+  template<auto address, auto value, auto mask, bool isStore>
+  __FORCE_INLINE static void _ModifyEntry(){
+    if constexpr (isStore) _Store<address>(value);
+    else _Update<address, value, mask>();
+  }
+
+  template<typename Coalesced, size_t... index>
+  __FORCE_INLINE static void _ModifyApply(std::index_sequence<index...>){
+    (_ModifyEntry<Coalesced::table.address[index], Coalesced::table.value[index],
+                  Coalesced::table.mask[index], Coalesced::table.isStore[index]>(), ...);
+  }
+
 /*!
-  @brief Set or Reset bits in the registers
+  @brief Set or Reset bits in the registers.
+    Accesses are coalesced at compile time: adjacent modifications of the same register are merged,
+    full-mask modifications are plain stores, no-op modifications are dropped
   @tparam <ValueList> list of values to set 
   @tparam <ReseMaskListtList> list of values to reset/mask
   @tparam <AddressesList> list of registers addresses to operate
 */
   template<bool isSet, typename AddressesList, typename ValueList, typename MaskList>
   __FORCE_INLINE static void _Modify(){
-    using namespace trait;
-
-    if constexpr (!is_empty_v<ValueList> && !is_empty_v<MaskList> && !is_empty_v<AddressesList>){
-
-      constexpr auto value = front_v<ValueList>;
-      constexpr auto mask = front_v<MaskList>;
-
-      if constexpr(value || mask){
-        constexpr auto address = front_v<AddressesList>;
-        
-        if constexpr (isSet) _Set<address, value, mask>();
-        else _Write<address, value, mask>();
-      }
-        
-      using restValue = pop_front_t<ValueList>;
-      using restMask = pop_front_t<MaskList>;
-      using restAddress = pop_front_t<AddressesList>;
-      
-      _Modify<isSet, restAddress, restValue, restMask>();
-    }
+    using coalesced = _Coalesce<isSet, AddressesList, ValueList, MaskList>;
+    if constexpr (coalesced::count)
+      _ModifyApply<coalesced>(std::make_index_sequence<coalesced::count>{});
   };
 
 protected:
@@ -75,7 +306,13 @@ protected:
   */
   template<auto address, auto mask>
   __FORCE_INLINE static void _Set(decltype(mask) value){
-      reg<address> = (reg<address> &(~mask)) | value;
+      if constexpr (_IsBitBand<address, mask>){
+        if (!(value & ~mask)){
+          _BitStore<address, mask>(value & mask);
+          return;
+        }
+      }
+      _Update<address>(value, mask);
   }
 
   /*!
@@ -85,7 +322,7 @@ protected:
   */
   template<auto address, auto value>
   __FORCE_INLINE static void _Set(){
-      reg<address> |= value;
+      _Update<address, value, value>();
   }
 
   /*!
@@ -96,7 +333,7 @@ protected:
   */
   template<auto address, auto value, auto mask>
   __FORCE_INLINE static void _Set(){
-      reg<address> = (reg<address> &(~mask)) | value;
+      _Update<address, value, mask>();
   }
 
   /*!
@@ -106,7 +343,7 @@ protected:
   */
   template<auto address, auto value>
   __FORCE_INLINE static void _Clear(){
-      reg<address> = reg<address> &(~value);
+      _Update<address, 0U, value>();
   }
 
   /*!
@@ -117,7 +354,7 @@ protected:
   */
   template<auto address, typename T>
   __FORCE_INLINE static void _Clear(T value){
-      reg<address> = reg<address> &(~value);
+      _Update<address>(0, value);
   }
 
   /*!
@@ -139,7 +376,7 @@ protected:
   */
   template<auto address, auto mask>
   __FORCE_INLINE static void _Write(decltype(mask) value){
-      reg<address> = mask & value;
+      _Store<address>(mask & value);
   }
 
   /*!
@@ -151,7 +388,7 @@ protected:
   template<auto address, typename T>
   __FORCE_INLINE static void _Write(T value){
       static_assert(std::is_integral_v<T>, "value should be an integral");
-      reg<address> = value;
+      _Store<address>(value);
   }
 
   /*!
@@ -162,7 +399,7 @@ protected:
   */
   template<auto address, auto value, auto mask>  
   __FORCE_INLINE static void _Write(){
-      reg<address> = mask & value;
+      _Store<address>(mask & value);
   }
 
   /*!
@@ -172,7 +409,7 @@ protected:
   */
   template<auto address, auto value>  
   __FORCE_INLINE static void _Write(){
-      reg<address> = value;
+      _Store<address>(value);
   }
 
   template<typename listAddresses, typename T, typename ... Types>  
@@ -180,7 +417,7 @@ protected:
     if constexpr (!trait::is_empty_v<listAddresses>){
       using restAddresses = trait::pop_front_t<listAddresses>;
       static constexpr auto address = trait::front_v<listAddresses>;
-      reg<address> = value;
+      _Store<address>(value);
       _Write<restAddresses, Types...>(values...);
     }
   }
@@ -188,7 +425,7 @@ protected:
   template<typename listAddresses, typename T>
   __FORCE_INLINE static void _Write(T value){
     static constexpr auto address = trait::front_v<listAddresses>;
-    reg<address> = value;
+    _Store<address>(value);
   }
 
   template<auto... addresses, typename T, typename ... Types>
@@ -204,7 +441,7 @@ protected:
     @tparam <accessType> type of mask and access to value of register
   */
   template<auto address, auto mask, typename accessType = decltype(address)>
-  __FORCE_INLINE static auto _Read(){ return mask & reg<address, accessType>; }
+  __FORCE_INLINE static auto _Read(){ return mask & _Load<address, accessType>(); }
 
   /*!
     @brief Read value of register
@@ -212,7 +449,7 @@ protected:
     @tparam <accessType> type of mask and access to value of register
   */
   template<auto address, typename accessType = decltype(address)>
-  __FORCE_INLINE static auto _Read(){ return reg<address, accessType>; }
+  __FORCE_INLINE static auto _Read(){ return _Load<address, accessType>(); }
 
   /*!
     @brief Read value of register
@@ -221,7 +458,19 @@ protected:
     @tparam [in] mask of value
   */
   template<auto address, typename accessType = decltype(address)>
-  __FORCE_INLINE static auto _Read(accessType mask){ return mask & reg<address, accessType>; }
+  __FORCE_INLINE static auto _Read(accessType mask){ return mask & _Load<address, accessType>(); }
+
+  /*!
+    @brief Get bus address of memory, e.g.: for DMA. Simulated address space maps host memory
+    @param [in] pointer to memory
+  */
+  __FORCE_INLINE static uint32_t _GetBusAddress(const volatile void* pointer){
+#if defined(REGISTERS_SIMULATION)
+    return simulation::Memory::GetBusAddress(pointer);
+#else
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(pointer));
+#endif
+  }
 
 };
 
@@ -0,0 +1,209 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Simulated address space of controller's registers. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _REGISTERS_SIMULATION_HPP
+#define _REGISTERS_SIMULATION_HPP
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+/*!
+  @brief Simulation of controller's hardware on host
+*/
+namespace controller::hardware::simulation{
+
+/*!
+  @brief Sparse simulated address space.
+    Used by Registers, if REGISTERS_SIMULATION is defined. Bit-band alias accesses are mapped to target bits.
+    Host memory for DMA is mapped to SRAM region of bus by windows, so addresses fit 32-bit registers
+*/
+class Memory{
+
+public:
+
+  Memory() = delete;
+
+  /*!
+    @brief Description of simulated register
+  */
+  struct Register{
+    /*! @brief Current value*/
+    uint32_t value = 0;
+    /*! @brief Value after Reset()*/
+    uint32_t reset = 0;
+    /*! @brief Bits are cleared by writing 1, writing 0 has no effect*/
+    uint32_t maskW1C = 0;
+    /*! @brief Bits are cleared by writing 0, writing 1 has no effect*/
+    uint32_t maskW0C = 0;
+    /*! @brief Bits are cleared after read*/
+    uint32_t maskRC = 0;
+    /*! @brief Bits are not affected by write*/
+    uint32_t maskReadOnly = 0;
+    /*! @brief Bits are always read as 0 and not affected by write*/
+    uint32_t maskReserved = 0;
+    /*! @brief Executes after read. Models hardware side-effects*/
+    void (*CallbackRead)(uint32_t address, uint32_t value) = nullptr;
+    /*! @brief Executes after write. Models hardware side-effects*/
+    void (*CallbackWrite)(uint32_t address, uint32_t value) = nullptr;
+  };
+
+  /*!
+    @brief Configure side-effects of register and set it to reset value
+    @param [in] address of register
+    @param [in] reset value of register
+    @param [in] maskW1C bits cleared by writing 1
+    @param [in] maskW0C bits cleared by writing 0
+    @param [in] maskRC bits cleared after read
+    @param [in] maskReadOnly bits not affected by write
+    @param [in] maskReserved bits read as 0 and not affected by write
+  */
+  static Register& Configure(uint32_t address, uint32_t reset = 0,
+                             uint32_t maskW1C = 0, uint32_t maskW0C = 0, uint32_t maskRC = 0,
+                             uint32_t maskReadOnly = 0, uint32_t maskReserved = 0){
+    auto& r = registers[address];
+    r.reset = reset & ~maskReserved;
+    r.value = r.reset;
+    r.maskW1C = maskW1C;
+    r.maskW0C = maskW0C;
+    r.maskRC = maskRC;
+    r.maskReadOnly = maskReadOnly;
+    r.maskReserved = maskReserved;
+    return r;
+  }
+
+  /*!
+    @brief Read register as controller's core does. Applies side-effects
+    @param [in] address of register
+  */
+  static uint32_t Read(uint32_t address){
+    if (_IsBitBandAlias(address))
+      return (Read(_GetBitBandAddress(address)) >> _GetBitBandBit(address)) & 1U;
+    auto& r = registers[address];
+    uint32_t value = r.value & ~r.maskReserved;
+    r.value &= ~r.maskRC;
+    if (r.CallbackRead) r.CallbackRead(address, value);
+    return value;
+  }
+
+  /*!
+    @brief Write register as controller's core does. Applies side-effects
+    @param [in] address of register
+    @param [in] value to write
+  */
+  static void Write(uint32_t address, uint32_t value){
+    if (_IsBitBandAlias(address)){
+      uint32_t target = _GetBitBandAddress(address);
+      uint32_t bit = 1U << _GetBitBandBit(address);
+      uint32_t word = Read(target);
+      Write(target, (value & 1U) ? (word | bit) : (word & ~bit));
+      return;
+    }
+    auto& r = registers[address];
+    uint32_t maskPlain = ~(r.maskW1C | r.maskW0C | r.maskRC | r.maskReadOnly | r.maskReserved);
+    uint32_t cleared = (value & r.maskW1C) | (~value & r.maskW0C);
+    r.value = (r.value & ~maskPlain & ~cleared) | (value & maskPlain);
+    if (r.CallbackWrite) r.CallbackWrite(address, value);
+  }
+
+  /*!
+    @brief Set value of register as peripheral does. No side-effects
+    @param [in] address of register
+    @param [in] value to set
+  */
+  static void Set(uint32_t address, uint32_t value){
+    auto& r = registers[address];
+    r.value = value & ~r.maskReserved;
+  }
+
+  /*!
+    @brief Get value of register as peripheral does. No side-effects
+    @param [in] address of register
+  */
+  static uint32_t Get(uint32_t address){
+    auto it = registers.find(address);
+    return it == registers.end() ? 0 : it->second.value;
+  }
+
+  /*!
+    @brief Get simulated register, e.g.: to add side-effect in test. Register is created, if not configured
+    @param [in] address of register
+  */
+  static Register& GetRegister(uint32_t address){ return registers[address]; }
+
+  /*!
+    @brief Set all configured registers to reset values
+  */
+  static void Reset(){
+    for (auto& [address, r] : registers)
+      r.value = r.reset;
+  }
+
+  /*!
+    @brief Remove all registers and their configuration
+  */
+  static void Clear(){ registers.clear(); }
+
+  /*!
+    @brief Get bus address of host memory, e.g.: buffer for DMA. 
+      Window of pointer is mapped with the next one, so transfer of up to sizeWindow elements stays mapped
+    @param [in] pointer to host memory
+  */
+  static uint32_t GetBusAddress(const volatile void* pointer){
+    auto host = reinterpret_cast<uintptr_t>(pointer);
+    if constexpr (sizeof(uintptr_t) <= sizeof(uint32_t)) return static_cast<uint32_t>(host);
+    uintptr_t window = host & ~(sizeWindow - 1);
+    size_t index = 0;
+    while (index + 1 < windows.size() && 
+           !(windows[index] == window && windows[index + 1] == window + sizeWindow)) ++index;
+    if (index + 1 >= windows.size()){
+      index = windows.size();
+      windows.push_back(window);
+      windows.push_back(window + sizeWindow);
+    }
+    return static_cast<uint32_t>(addressSRAM + index * sizeWindow + (host - window));
+  }
+
+  /*!
+    @brief Get host memory by bus address, e.g.: memory address of DMA channel
+    @param [in] address on the bus, returned by GetBusAddress
+  */
+  static void* GetPointer(uint32_t address){
+    if constexpr (sizeof(uintptr_t) <= sizeof(uint32_t)) return reinterpret_cast<void*>(address);
+    size_t index = (address - addressSRAM) / sizeWindow;
+    if (address < addressSRAM || index >= windows.size()) return nullptr;
+    return reinterpret_cast<void*>(windows[index] + (address - addressSRAM) % sizeWindow);
+  }
+
+private:
+
+  static inline std::unordered_map<uint32_t, Register> registers;
+
+    // Host memory windows mapped to SRAM region below bit-band alias
+  static constexpr uint32_t addressSRAM = 0x20000000;
+  static constexpr uintptr_t sizeWindow = 0x40000;
+  static inline std::vector<uintptr_t> windows;
+
+    // Bit-band alias regions of Cortex-M3: SRAM and peripherals.
+    // Bus matrix makes read-modify-write of target word on alias store
+  static bool _IsBitBandAlias(uint32_t address){
+    return (address >= 0x22000000 && address < 0x24000000) ||
+           (address >= 0x42000000 && address < 0x44000000);
+  }
+
+  static uint32_t _GetBitBandAddress(uint32_t address){
+    return (address & 0xF0000000) + (((address & 0x01FFFFFF) >> 5) & ~3U);
+  }
+
+  static uint32_t _GetBitBandBit(uint32_t address){ return (address >> 2) & 31U; }
+
+};
+
+} // !namespace controller::hardware::simulation
+
+#endif // !_REGISTERS_SIMULATION_HPP
@@ -0,0 +1,229 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Trace of registers accesses and bus cycles counters
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _REGISTERS_TRACE_HPP
+#define _REGISTERS_TRACE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "../Compiler/Compiler.h"
+
+#ifndef REGISTERS_TRACE_SIZE
+  #define REGISTERS_TRACE_SIZE 256
+#endif
+
+#ifndef REGISTERS_TRACE_ADDRESSES
+  #define REGISTERS_TRACE_ADDRESSES 64
+#endif
+
+/*!
+  @brief Trace of registers accesses
+*/
+namespace controller::hardware::trace{
+
+/*!
+  @brief Type of access to register
+*/
+enum class access : uint8_t{
+  /*! @brief Plain load*/
+  Read,
+  /*! @brief Plain store*/
+  Write,
+  /*! @brief Load, modify and store*/
+  ReadModifyWrite
+};
+
+/*!
+  @brief Record of trace
+*/
+struct Record{
+  uint32_t address;
+  uint32_t value;
+  uint32_t mask;
+  trace::access access;
+};
+
+/*!
+  @brief Counters of accesses to one register
+*/
+struct Counter{
+  uint32_t address;
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t modifies;
+
+  /*!
+    @brief Number of bus cycles. Read-modify-write costs load and store
+  */
+  __FORCE_INLINE uint32_t GetBusCycles() const { return reads + writes + 2*modifies; }
+};
+
+/*!
+  @brief Lock-free trace ring and per-address counters.
+    Used by Registers, if REGISTERS_TRACE is defined.
+    Size of ring is REGISTERS_TRACE_SIZE, number of counted addresses is REGISTERS_TRACE_ADDRESSES
+*/
+class Trace{
+
+public:
+
+  Trace() = delete;
+
+  /*!
+    @brief Add access to trace. Safe to call from ISR and main loop
+    @param [in] access type of access
+    @param [in] address of register
+    @param [in] value read or written
+    @param [in] mask of modified bits
+  */
+  static void Add(trace::access access, uint32_t address, uint32_t value, uint32_t mask){
+    if (!isEnabled.load(std::memory_order_relaxed)) return;
+    size_t index = position.fetch_add(1, std::memory_order_relaxed) & (size - 1);
+    ring[index] = Record{address, value, mask, access};
+    if (auto slot = _FindSlot(address, true); slot){
+      switch(access){
+        case trace::access::Read: slot->reads.fetch_add(1, std::memory_order_relaxed); break;
+        case trace::access::Write: slot->writes.fetch_add(1, std::memory_order_relaxed); break;
+        default: slot->modifies.fetch_add(1, std::memory_order_relaxed); break;
+      }
+    }
+  }
+
+  /*!
+    @brief Start or stop recording
+  */
+  __FORCE_INLINE static void Enable(bool isEnable = true){ isEnabled.store(isEnable, std::memory_order_relaxed); }
+
+  /*!
+    @brief Get number of accesses since Reset. Can be more than stored in ring
+  */
+  __FORCE_INLINE static size_t GetCount(){ return position.load(std::memory_order_relaxed); }
+
+  /*!
+    @brief Get number of records stored in ring
+  */
+  __FORCE_INLINE static size_t GetRecordsCount(){
+    size_t count = GetCount();
+    return count > size ? size : count;
+  }
+
+  /*!
+    @brief Get record from ring. Stop recording before reading
+    @param [in] index of record, 0 - the oldest stored one
+  */
+  static Record GetRecord(size_t index){
+    size_t count = GetCount();
+    size_t first = count > size ? count - size : 0;
+    return ring[(first + index) & (size - 1)];
+  }
+
+  /*!
+    @brief Get counters of register
+    @param [in] address of register
+    @return counters. All zero, if register was not accessed
+  */
+  static Counter GetCounter(uint32_t address){
+    auto slot = _FindSlot(address, false);
+    if (!slot) return Counter{address, 0, 0, 0};
+    return Counter{address,
+                   slot->reads.load(std::memory_order_relaxed),
+                   slot->writes.load(std::memory_order_relaxed),
+                   slot->modifies.load(std::memory_order_relaxed)};
+  }
+
+  /*!
+    @brief Get counters of all registers accessed since Reset
+    @param [out] destination array of counters
+    @param [in] length of destination array
+    @return number of counters written
+  */
+  static size_t GetCounters(Counter* destination, size_t length){
+    size_t count = 0;
+    for (auto& slot : slots){
+      uint32_t address = slot.address.load(std::memory_order_acquire);
+      if (!address || count >= length) continue;
+      destination[count++] = GetCounter(address);
+    }
+    return count;
+  }
+
+  /*!
+    @brief Get sum of bus cycles of all registers since Reset
+  */
+  static uint32_t GetBusCycles(){
+    uint32_t cycles = 0;
+    for (auto& slot : slots){
+      cycles += slot.reads.load(std::memory_order_relaxed) +
+                slot.writes.load(std::memory_order_relaxed) +
+                2*slot.modifies.load(std::memory_order_relaxed);
+    }
+    return cycles;
+  }
+
+  /*!
+    @brief Get number of accesses, that were not counted due to lack of free counters
+  */
+  __FORCE_INLINE static uint32_t GetLost(){ return lost.load(std::memory_order_relaxed); }
+
+  /*!
+    @brief Clear ring and counters. Stop recording before reset
+  */
+  static void Reset(){
+    for (auto& slot : slots){
+      slot.address.store(0, std::memory_order_relaxed);
+      slot.reads.store(0, std::memory_order_relaxed);
+      slot.writes.store(0, std::memory_order_relaxed);
+      slot.modifies.store(0, std::memory_order_relaxed);
+    }
+    lost.store(0, std::memory_order_relaxed);
+    position.store(0, std::memory_order_relaxed);
+  }
+
+private:
+
+  struct Slot{
+    std::atomic<uint32_t> address;
+    std::atomic<uint32_t> reads;
+    std::atomic<uint32_t> writes;
+    std::atomic<uint32_t> modifies;
+  };
+
+  static constexpr size_t size = REGISTERS_TRACE_SIZE;
+  static constexpr size_t sizeSlots = REGISTERS_TRACE_ADDRESSES;
+
+  static_assert((size & (size - 1)) == 0, "REGISTERS_TRACE_SIZE should be power of 2");
+  static_assert((sizeSlots & (sizeSlots - 1)) == 0, "REGISTERS_TRACE_ADDRESSES should be power of 2");
+
+  static inline std::atomic<bool> isEnabled = true;
+  static inline std::atomic<size_t> position = 0;
+  static inline std::atomic<uint32_t> lost = 0;
+  static inline Record ring[size] {};
+  static inline Slot slots[sizeSlots] {};
+
+  // Open addressing. Registers are word aligned, so low 2 bits are dropped
+  static Slot* _FindSlot(uint32_t address, bool isInsert){
+    size_t index = (address >> 2) & (sizeSlots - 1);
+    for (size_t i = 0; i < sizeSlots; ++i, index = (index + 1) & (sizeSlots - 1)){
+      uint32_t current = slots[index].address.load(std::memory_order_acquire);
+      if (current == address) return &slots[index];
+      if (current) continue;
+      if (!isInsert) return nullptr;
+      if (slots[index].address.compare_exchange_strong(current, address, std::memory_order_acq_rel) ||
+          current == address)
+        return &slots[index];
+    }
+    if (isInsert) lost.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+};
+
+} // !namespace controller::hardware::trace
+
+#endif // !_REGISTERS_TRACE_HPP
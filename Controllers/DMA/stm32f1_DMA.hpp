@@ -9,9 +9,18 @@
 #ifndef _STM32F1_DMA_HPP
 #define _STM32F1_DMA_HPP
 
+#include <cstddef>
 #include <cstdint>
+#include <atomic>
 #include "../Common/Compiler/Compiler.h"
 #include "../Common/Core/Registers.hpp"
+#include "../../Containers/Circular_Buffer.hpp"
+#include "../../Utils/type_traits_custom.hpp"
+
+  // Number of queued transfers per priority of shared channel
+#ifndef DMA_QUEUE_SIZE
+  #define DMA_QUEUE_SIZE 4
+#endif
 
 /*!
   @brief Controller's peripherals devices
@@ -83,6 +92,16 @@ enum class isr{
   ISR_TC_HT = 6
 };
 
+/*!
+  @brief Priority of channel. Requests of channels with equal priority are served by channel number
+*/
+enum class priority{
+  Low = 0,
+  Medium = 0x1000,
+  High = 0x2000,
+  VeryHigh = 0x3000
+};
+
 } // !namespace configuration::dma
 
 
@@ -91,6 +110,31 @@ class DMA : public controller::hardware::Registers{
 
 public:
 
+  /*!
+    @brief Identifier of channel: (dmaID << 4) | channel. Used to find channels shared by peripherals
+  */
+  static constexpr uint8_t id = (dmaID << 4) | channel;
+
+  /*!
+    @brief Value of configuration register of channel. Channel is disabled
+    @tparam <minc> memory increment mode
+    @tparam <pinc> peripheral increment mode
+    @tparam <dir> direction of read/write
+    @tparam <circ> circular mode
+    @tparam <isr> interruprts to enable
+    @tparam <mSize> size of element in memory
+    @tparam <pSize> size of peripherals element
+    @tparam <pl> priority of channel
+  */
+  template<configuration::dma::minc minc, configuration::dma::pinc pinc, 
+           configuration::dma::dir dir, configuration::dma::circ circ, configuration::dma::isr isr,
+           configuration::dma::data_size mSize = configuration::dma::data_size::Size_8,
+           configuration::dma::data_size pSize = configuration::dma::data_size::Size_8,
+           configuration::dma::priority pl = configuration::dma::priority::Low>
+  static constexpr uint32_t valueConfig = (uint32_t)minc | (uint32_t)pinc |
+                                          (uint32_t)circ | (uint32_t)dir  | (uint32_t)isr |
+                                          ((uint32_t)mSize & 0x300) | ((uint32_t)pSize & 0xC00) | (uint32_t)pl;
+
   /*!
     @brief Initialization of DMA channel
     @tparam <enable> enable channel after initialization
@@ -101,19 +145,36 @@ public:
     @tparam <isr> interruprts to enable
     @tparam <mSize> size of element in memory
     @tparam <pSize> size of peripherals element
+    @tparam <pl> priority of channel
   */
   template<bool enable, configuration::dma::minc minc, configuration::dma::pinc pinc, 
            configuration::dma::dir dir, configuration::dma::circ circ, configuration::dma::isr isr,
            configuration::dma::data_size mSize = configuration::dma::data_size::Size_8,
-           configuration::dma::data_size pSize = configuration::dma::data_size::Size_8>
+           configuration::dma::data_size pSize = configuration::dma::data_size::Size_8,
+           configuration::dma::priority pl = configuration::dma::priority::Low>
   __FORCE_INLINE static void Init(){
-    static constexpr uint32_t value = (uint32_t)minc | (uint32_t)pinc |
-                                      (uint32_t)circ | (uint32_t)dir  |
-                                      (enable ? mask::CCR::EN : 0) | (uint32_t)isr |
-                                      ((uint32_t)mSize & 0x300) | ((uint32_t)pSize & 0xC00);
+    static constexpr uint32_t value = valueConfig<minc, pinc, dir, circ, isr, mSize, pSize, pl> | 
+                                      (enable ? mask::CCR::EN : 0);
     Registers::_Write<address::CCR, value>();
   }
 
+  /*!
+    @brief Write configuration of disabled channel, e.g.: channel is shared by several peripherals
+    @param [in] value of configuration register. See valueConfig
+  */
+  __FORCE_INLINE static void SetConfig(uint32_t value){
+    Registers::_Write<address::CCR>(value & ~mask::CCR::EN);
+  }
+
+  /*!
+    @brief Set priority of channel
+    @tparam <pl> priority
+  */
+  template<configuration::dma::priority pl>
+  __FORCE_INLINE static void SetPriority(){
+    Registers::_Set<address::CCR, (uint32_t)pl, mask::CCR::PL>();
+  }
+
   /*!
     @brief Set peripherals address
     @tparam <address> address to set
@@ -148,6 +209,14 @@ public:
     Registers::_Write<address::CMAR>(memoryAddress);
   }
 
+  /*!
+    @brief Set memory address
+    @param [in] memory to transfer from/to
+  */
+  __FORCE_INLINE static void SetMemory(const volatile void* memory){
+    Registers::_Write<address::CMAR>(Registers::_GetBusAddress(memory));
+  }
+
   /*!
     @brief Set count of elements to transfer
     @tparam <count> of elements
@@ -180,6 +249,13 @@ public:
     Registers::_Write<address::IFCR, mask::IFCR::CLEAR>();
   }
 
+  /*!
+    @brief Clear half transfer flag. Transfer complete flag is kept
+  */
+  __FORCE_INLINE static void ClearHalfTransfer(){
+    Registers::_Write<address::IFCR, mask::IFCR::HT>();
+  }
+
   /*!
     @brief Disable channel
   */
@@ -235,6 +311,7 @@ private:
     struct CCR{
       static constexpr uint32_t
         EN = 1, // Enable
+        PL = 3 << 12, // Priority level
         MINC = 1 << 7, // Peripheral increment
         PINC = 1 << 6, // Circular mode
         DIR = 1 << 4, // Direction
@@ -248,12 +325,176 @@ private:
     };
     struct IFCR{
       static constexpr uint32_t
-        CLEAR = 0xF <<  4*(channel - 1);
+        CLEAR = 0xF <<  4*(channel - 1),
+        HT = 1 << (4*(channel - 1) + 2);
     };
   };
 
 };
 
+/*!
+  @brief Compile-time check of DMA channels used by peripherals
+*/
+class DMAManager{
+
+  DMAManager() = delete;
+
+public:
+
+  /*!
+    @brief Check, that several peripherals use the same DMA channel, e.g.: UART1 TX and SPI2 RX (DMA1, channel 4)
+    @tparam <peripherals...> list of peripherals
+  */
+  template<typename... peripherals>
+  static constexpr bool isConflict = 
+    trait::size_of_list_v<trait::lists_expand_t<typename peripherals::initialization::channelsDMA...>> != 
+    trait::size_of_list_v<trait::make_unique_t<trait::lists_expand_t<typename peripherals::initialization::channelsDMA...>>>;
+
+  /*!
+    @brief Assert, that peripherals don't share DMA channels. 
+      UART and SPI with DMA program their channels directly and can't share them: 
+      conflict is resolved by other channel mode(ISR) or by other peripheral
+    @tparam <peripherals...> list of peripherals
+  */
+  template<typename... peripherals>
+  __FORCE_INLINE static void Check(){
+    static_assert(!isConflict<peripherals...>, "DMA channel is used by several peripherals. Use DMAChannel to share it");
+  }
+
+};
+
+/*!
+  @brief Time-sharing of DMA channel. Static class.
+    Each transfer configures channel from its descriptor, so channel is shared by several producers of transfers,
+    e.g.: memory to memory copy and ADC. Channel should not be used by UART or SPI with DMA: they don't request transfers.
+    Queued transfers are started by priority, transfers with equal priority - in order of request.
+    ISR should be called from interrupt of channel. Producers of transfers with equal priority should not preempt each other
+  @tparam <dmaID> number of DMA
+  @tparam <channel> number of channel
+  @tparam <queueSize> max number of queued transfers per priority
+*/
+template<uint8_t dmaID, uint8_t channel, size_t queueSize = DMA_QUEUE_SIZE>
+class DMAChannel{
+
+  DMAChannel() = delete;
+
+  using dma = DMA<dmaID, channel>;
+
+public:
+
+  /*!
+    @brief Descriptor of transfer
+  */
+  struct Transfer{
+    /*! @brief Configuration of channel with priority, e.g.: DMA::valueConfig. Circular mode holds channel till Abort*/
+    uint32_t config;
+    /*! @brief Address of peripheral*/
+    uint32_t peripheral;
+    /*! @brief Memory to transfer from/to. Converted to bus address on start*/
+    const volatile void* memory;
+    /*! @brief Number of elements*/
+    uint16_t count;
+    /*! @brief Called from ISR after transfer. Channel is free, so callback may request next transfer*/
+    void (*callback)();
+  };
+
+  /*!
+    @brief Request transfer. Transfer starts at once, if channel is free
+    @param [in] transfer descriptor
+    @return false, if queue of priority is full
+  */
+  static bool Request(const Transfer& transfer){
+    if (!queue[_GetLevel(transfer.config)].Push(transfer)) return false;
+    _Dispatch();
+    return true;
+  }
+
+  /*!
+    @brief Handler of channel interrupt. Finishes current transfer and starts the next one
+  */
+  static void ISR(){
+    dma::ClearFlags();
+    dma::Disable();
+    _Complete();
+  }
+
+  /*!
+    @brief Stop current transfer, e.g.: circular one. Callback is called
+  */
+  static void Abort(){
+    if (!isBusy.load(std::memory_order_acquire)) return;
+    dma::Disable();
+    dma::ClearFlags();
+    _Complete();
+  }
+
+  /*!
+    @brief Check that transfer is in progress
+  */
+  __FORCE_INLINE static bool IsBusy(){ return isBusy.load(std::memory_order_relaxed); }
+
+  /*!
+    @brief Get number of queued transfers
+  */
+  static size_t GetQueued(){
+    size_t count = 0;
+    for (auto& level : queue) count += level.GetCount();
+    return count;
+  }
+
+private:
+
+  static constexpr size_t countLevels = 4;
+  static constexpr uint32_t shiftLevel = 12;
+
+  static inline container::CircularBuffer<Transfer, queueSize, 
+                                          container::overflow::Drop, container::storage::Atomic> queue[countLevels];
+  static inline std::atomic<bool> isBusy = false;
+  static inline void (*callback)() = nullptr;
+
+  __FORCE_INLINE static size_t _GetLevel(uint32_t config){ return (config >> shiftLevel) & (countLevels - 1); }
+
+  static void _Complete(){
+    auto done = callback;
+    callback = nullptr;
+    isBusy.store(false, std::memory_order_release);
+    if (done) done();
+    _Dispatch();
+  }
+
+    // Owner of busy flag is the only consumer of queues. 
+    // Queues are checked again after release, so request during release is not lost
+  static void _Dispatch(){
+    while (_IsPending() && !isBusy.exchange(true, std::memory_order_acquire)){
+      if (_StartNext()) return;
+      isBusy.store(false, std::memory_order_release);
+    }
+  }
+
+  static bool _IsPending(){
+    for (auto& level : queue)
+      if (!level.IsEmpty()) return true;
+    return false;
+  }
+
+  static bool _StartNext(){
+    for (size_t level = countLevels; level--;){
+      if (queue[level].IsEmpty()) continue;
+      Transfer transfer = queue[level].Pop();
+      callback = transfer.callback;
+      dma::SetConfig(transfer.config);
+      dma::SetPeripheral(transfer.peripheral);
+      dma::SetMemory(transfer.memory);
+      dma::SetCount(transfer.count);
+      dma::ClearFlags();
+      dma::Enable();
+      return true;
+    }
+    return false;
+  }
+
+};
+
 } // !namespace controller
 
 #endif // !_STM32F1_DMA_HPP
\ No newline at end of file
@@ -9,10 +9,18 @@
 #ifndef _ICONNECTION_HPP
 #define _ICONNECTION_HPP
 
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
 #include "../Common/Core/Interface.hpp"
 #include "../Common/Compiler/Compiler.h"
 #include "../../Containers/Circular_Buffer.hpp"
+#include "../../Utils/Coroutine.hpp"
+
+  // Number of rx timestamps in side ring. 0 - timestamps are disabled
+#ifndef CONNECTION_RX_TIMESTAMPS
+  #define CONNECTION_RX_TIMESTAMPS 0
+#endif
 
 /*!
   @brief Controller's common interfaces
@@ -48,43 +56,71 @@ struct IConnection{
   /*!
     @brief Write data to transmitter
     @param [in] data to send
-    @return true, if tx buffer not overflowed
+    @return false, if data doesn't fit tx buffer and is dropped
   */ 
   static bool Write(Type data){
-    bool isOverflow = txBuffer.Push(data);
+    bool isPushed = txBuffer.Push(data);
     adapter::_Send();
-    return isOverflow;
+    return isPushed;
   }
 
   /*!
-    @brief Write data to transmitter
+    @brief Write data to transmitter. Array is written as a whole: if it doesn't fit free space of tx buffer,
+      nothing is written and all elements are counted by GetTxDropped, so frame is never sent in part.
+      Longer data is written by parts of GetTxFree or by awaitable Write
     @param [in] pointer to data array
     @param [in] size of data to write
-    @return true, if tx buffer not overflowed
+    @return false, if data doesn't fit tx buffer and is dropped
   */ 
   static bool Write(const Type* data, size_t size){
-    bool isOverflow = txBuffer.Push(data, size);
+    bool isPushed = txBuffer.Push(data, size);
     adapter::_Send();
-    return isOverflow;
+    return isPushed;
   }
 
   /*!
-    @brief Write char-data to transmitter
+    @brief Write char-data to transmitter. Array is written as a whole, see Write(const Type*, size_t)
     @param [in] pointer to char-data array
     @param [in] size of char-data to write
-    @return true, if tx buffer not overflowed
+    @return false, if data doesn't fit tx buffer and is dropped
   */ 
   static bool Write(const char* data, size_t size){
-    bool isOverflow = txBuffer.Push(reinterpret_cast<const uint8_t*>(data), size);
+    static_assert(sizeof(Type) == 1, "Char-data requires 8-bit elements");
+    bool isPushed = txBuffer.Push(reinterpret_cast<const uint8_t*>(data), size);
     adapter::_Send();
-    return isOverflow;
+    return isPushed;
   }
 
   /*!
-    @brief Push data to tx buffer
+    @brief Write caller-owned data without copying to tx buffer. Data is handed to DMA directly.
+      Data belongs to transfer till completion is called, so completion is required
+    @param [in] data span of data to send
+    @param [in] completion called from ISR after data is sent
+    @return false, if transfer can't be queued
+  */
+  static bool Write(container::Span<const Type> data, void (*completion)()){
+    return adapter::Enqueue(data.data, data.size, completion);
+  }
+
+  /*!
+    @brief Write data with static storage duration without copying to tx buffer.
+      Lifetime of data is checked at compile time
+    @tparam <data> array with static storage duration
+    @param [in] completion called from ISR after data is sent
+    @return false, if transfer can't be queued
+  */
+  template<auto& data>
+  static bool Write(void (*completion)() = nullptr){
+    using element = std::remove_cv_t<std::remove_extent_t<std::remove_reference_t<decltype(data)>>>;
+    static_assert(std::is_same_v<element, Type>, "Data should be array of buffer's type");
+    return adapter::Enqueue(data, std::extent_v<std::remove_reference_t<decltype(data)>>, completion);
+  }
+
+  /*!
+    @brief Push data to tx buffer. Array is written as a whole, see Write(const Type*, size_t)
     @param [in] pointer to data array
     @param [in] size of data to Push
-    @return true, if tx buffer not overflowed
+    @return false, if data doesn't fit tx buffer and is dropped
   */ 
   static bool Push(const Type* data, size_t size){
     return txBuffer.Push(data, size);
@@ -93,7 +129,7 @@ struct IConnection{
   /*!
     @brief Push data to tx buffer
     @param [in] data to send
-    @return true, if tx buffer not overflowed
+    @return false, if data doesn't fit tx buffer and is dropped
   */
   static bool Push(const Type data){
     return txBuffer.Push(data);
@@ -136,6 +172,14 @@ struct IConnection{
     return txBuffer.GetCount(); 
   }
 
+  /*!
+    @brief Return number of elements, that can be written to tx buffer without drop
+  */
+  __FORCE_INLINE static size_t GetTxFree(){
+    adapter::_CheckTxBuffer();
+    return txBuffer.GetCountToOverflow(); 
+  }
+
   /*!
     @brief Check the rx buffer
     @return true if rx buffer is empty
@@ -175,6 +219,21 @@ struct IConnection{
     return rxBuffer.Pop(destination, length);
   }
 
+  /*!
+    @brief Get received data in place, without copying
+    @return up to two contiguous spans from head of rx buffer. Valid till ConsumeRx
+  */
+  __FORCE_INLINE static auto PeekRx(){
+    adapter::_CheckRxBuffer();
+    return rxBuffer.PeekRead();
+  }
+
+  /*!
+    @brief Drop received data read in place after PeekRx
+    @param [in] length number of elements
+  */
+  __FORCE_INLINE static void ConsumeRx(size_t length){ rxBuffer.ConsumeRead(length); }
+
   /*!
     @brief Get element from rx buffer
     @param [in] index of element
@@ -194,6 +253,76 @@ struct IConnection{
   */
   __FORCE_INLINE static void FlushRX() { rxBuffer.Flush(); }
 
+  /*!
+    @brief Get number of elements dropped on overflow of tx buffer: all elements of arrays, that didn't fit
+  */
+  __FORCE_INLINE static size_t GetTxDropped(){ return txBuffer.GetDropped(); }
+
+  /*!
+    @brief Get max number of elements in tx buffer. Used to size buffer from field data
+  */
+  __FORCE_INLINE static size_t GetTxHighWater(){ return txBuffer.GetHighWater(); }
+
+  /*!
+    @brief Get number of elements lost on overflow of rx buffer
+  */
+  __FORCE_INLINE static size_t GetRxDropped(){
+    adapter::_CheckRxBuffer();
+    return rxBuffer.GetDropped();
+  }
+
+  /*!
+    @brief Get max number of elements in rx buffer. Used to size buffer from field data
+  */
+  __FORCE_INLINE static size_t GetRxHighWater(){
+    adapter::_CheckRxBuffer();
+    return rxBuffer.GetHighWater();
+  }
+
+  /*!
+    @brief Reset overflow statistics of tx and rx buffers
+  */
+  __FORCE_INLINE static void ResetStatistics(){
+    txBuffer.ResetStatistics();
+    rxBuffer.ResetStatistics();
+  }
+
+  /*!
+    @brief Get time of arrival of rx element: time of the first rx event after element is received.
+      Events are defined by adapter, e.g.: first element after IDLE line, DMA transfer, IDLE line.
+      Requires CONNECTION_RX_TIMESTAMPS > 0
+    @param [in] index of element from head of rx buffer
+    @param [out] time timestamp of adapter, e.g.: cycles of core
+    @return false, if timestamp is not recorded yet or overwritten
+  */
+  static bool GetRxTimestamp(size_t index, uint32_t& time){
+    if constexpr (isRxTimestamps){
+      adapter::_CheckRxBuffer();
+        // Counter and buffer are updated by ISR together: snapshot is taken, when counter is the same before and after
+      size_t received, count;
+      do{
+        received = rxReceived;
+        __COMPILER_BARRIER();
+        count = rxBuffer.GetCount();
+        __COMPILER_BARRIER();
+      } while (received != rxReceived);
+      size_t position = received - count + index + 1;
+      size_t written = rxStamped;
+      size_t oldest = written > sizeRxTimestamps ? written - sizeRxTimestamps : 0;
+      for (size_t i = oldest; i < written; ++i){
+        const auto& stamp = rxTimestamps[i % sizeRxTimestamps];
+        if (static_cast<ptrdiff_t>(stamp.position - position) >= 0){
+            // Overwritten entry before the oldest one could be the first event after element
+          if (i == oldest && oldest) return false;
+          time = stamp.time;
+            // Entry could be overwritten by adapter during read
+          return rxStamped - i <= sizeRxTimestamps;
+        }
+      }
+    }
+    return false;
+  }
+
   /*!
     @brief Callback for TX Idle state
   */
@@ -214,9 +343,199 @@ struct IConnection{
   */
   using type = Type;
 
+  /*!
+    @brief Size of tx buffer in elements
+  */
+  static constexpr size_t sizeTxBuffer = txSize;
+
+  /*!
+    @brief Size of rx buffer in elements
+  */
+  static constexpr size_t sizeRxBuffer = rxSize;
+
+#if defined(__cpp_impl_coroutine)
+
+  /*!
+    @brief Awaitable write: data is copied to tx buffer by parts, as buffer becomes free.
+      Coroutine is resumed, when all data is in tx buffer. Only one coroutine may wait for tx
+    @param [in] data span of data. Should be valid till resumption
+  */
+  [[nodiscard]] static auto Write(container::Span<const Type> data){ return _AwaitWrite{data}; }
+
+  /*!
+    @brief Awaitable read: coroutine is resumed, when rx buffer has number of elements.
+      Only one coroutine may wait for rx
+    @param [in] count number of elements
+  */
+  [[nodiscard]] static auto ReadExactly(size_t count){ return _AwaitRead{nullptr, count}; }
+
+  /*!
+    @brief Awaitable read: coroutine is resumed, when rx buffer has number of elements, 
+      and elements are poped to destination
+    @param [out] destination pointer to array
+    @param [in] count number of elements
+  */
+  [[nodiscard]] static auto ReadExactly(Type* destination, size_t count){ return _AwaitRead{destination, count}; }
+
+  /*!
+    @brief Awaitable idle: coroutine is resumed, when tx buffer is empty
+  */
+  [[nodiscard]] static auto WaitIdle(){ return _AwaitWrite{{nullptr, 0}}; }
+
+#endif
+
 protected:
 
-  static inline container::CircularBuffer<Type, txSize> txBuffer;
+#if defined(__cpp_impl_coroutine)
+
+    // Suspended coroutines are owned by one side: the one, that exchanges handle to nullptr.
+    // So ISR and awaiter never resume coroutine or push tx data at the same time
+  static inline std::atomic<void*> awaitingTx = nullptr;
+  static inline std::atomic<void*> awaitingRx = nullptr;
+  static inline container::Span<const Type> txPending;
+  static inline size_t rxAwaited = 0;
+
+  struct _AwaitWrite{
+    container::Span<const Type> data;
+
+    bool await_ready(){
+      if (data.size) return false;
+      adapter::_CheckTxBuffer();
+      return txBuffer.IsEmpty();
+    }
+
+      // Till handle is stored, awaiter is the only owner, so coroutine continues, if data fits at once.
+      // Storing of handle is the last access to awaiter: ISR may resume coroutine and destroy awaiter.
+      // Handle is not taken back, tx idle before store is handled the same way as ISR does
+    bool await_suspend(std::coroutine_handle<> handle){
+      txPending = data;
+      bool isDone = _StepTx();
+      adapter::_Send();
+      if (isDone) return false;
+      awaitingTx.store(handle.address(), std::memory_order_release);
+      _ResumeTx();
+      return true;
+    }
+
+    void await_resume(){}
+  };
+
+  struct _AwaitRead{
+    Type* destination;
+    size_t count;
+
+    bool await_ready(){ return GetRxCount() >= count; }
+
+      // Storing of handle is the last access to awaiter: ISR may resume coroutine and destroy awaiter.
+      // Handle is not taken back, elements received before store are handled the same way as ISR does
+    bool await_suspend(std::coroutine_handle<> handle){
+      rxAwaited = count;
+      awaitingRx.store(handle.address(), std::memory_order_release);
+      _ResumeRx();
+      return true;
+    }
+
+    void await_resume(){ if (destination) rxBuffer.Pop(destination, count); }
+  };
+
+    // Push part of pending data. Return true, if all data is pushed and tx is idle for WaitIdle
+  static bool _StepTx(){
+    if (!txPending.size) return txBuffer.IsEmpty();
+    size_t count = txBuffer.GetCountToOverflow();
+    if (count > txPending.size) count = txPending.size;
+    txBuffer.Push(txPending.data, count);
+    txPending = container::Span<const Type>{txPending.data + count, txPending.size - count};
+    return !txPending.size;
+  }
+
+    // Owner of handle is the side, that exchanged it to nullptr: pending data and awaited count belong to it.
+    // Event before handle is stored back is not notified, so state is checked again after store
+  static void _ResumeTx(){
+    void* address = awaitingTx.exchange(nullptr, std::memory_order_acq_rel);
+    while (address){
+      bool isDone = _StepTx();
+      if (!isDone) awaitingTx.store(address, std::memory_order_release);
+      adapter::_Send();
+      if (isDone){
+        std::coroutine_handle<>::from_address(address).resume();
+        return;
+      }
+      if (!txBuffer.IsEmpty()) return;
+      address = awaitingTx.exchange(nullptr, std::memory_order_acq_rel);
+    }
+  }
+
+  static void _ResumeRx(){
+    void* address = awaitingRx.exchange(nullptr, std::memory_order_acq_rel);
+    while (address){
+      if (rxBuffer.GetCount() >= rxAwaited){
+        std::coroutine_handle<>::from_address(address).resume();
+        return;
+      }
+      awaitingRx.store(address, std::memory_order_release);
+      if (rxBuffer.GetCount() < rxAwaited) return;
+      address = awaitingRx.exchange(nullptr, std::memory_order_acq_rel);
+    }
+  }
+
+#endif
+
+    // Adapter calls on rx event: resumes awaiting coroutine and calls CallbackRxNotEmpty
+  static void _NotifyRx(){
+#if defined(__cpp_impl_coroutine)
+    if (awaitingRx.load(std::memory_order_relaxed)) _ResumeRx();
+#endif
+    if (CallbackRxNotEmpty) CallbackRxNotEmpty();
+  }
+
+    // Adapter calls on tx idle: pushes pending data, resumes awaiting coroutine and calls CallbackIdleTX
+  static void _NotifyIdleTx(){
+#if defined(__cpp_impl_coroutine)
+    _ResumeTx();
+#endif
+    if (CallbackIdleTX) CallbackIdleTX();
+  }
+
+    // Adapter checks, whether rx event should be notified
+  __FORCE_INLINE static bool _IsRxNotified(){
+#if defined(__cpp_impl_coroutine)
+    if (awaitingRx.load(std::memory_order_relaxed)) return true;
+#endif
+    return CallbackRxNotEmpty != nullptr;
+  }
+
+    // Position of rx stream(number of received elements) and time of rx event
+  struct _Timestamp{
+    size_t position;
+    uint32_t time;
+  };
+
+  static constexpr bool isRxTimestamps = CONNECTION_RX_TIMESTAMPS > 0;
+    // Size of side ring is never 0, so disabled timestamps compile without division by zero
+  static constexpr size_t sizeRxTimestamps = isRxTimestamps ? CONNECTION_RX_TIMESTAMPS : 1;
+  static inline _Timestamp rxTimestamps[sizeRxTimestamps];
+  static inline volatile size_t rxStamped = 0;
+  static inline volatile size_t rxReceived = 0;
+
+    // Adapter counts elements added to rx buffer
+  __FORCE_INLINE static void _CountRx(size_t count){
+    if constexpr (isRxTimestamps) rxReceived = rxReceived + count;
+  }
+
+    // Adapter records time of rx event. Event without new elements keeps earlier time
+  __FORCE_INLINE static void _StampRx(uint32_t time){
+    if constexpr (isRxTimestamps){
+      size_t written = rxStamped;
+      size_t position = rxReceived;
+      if (written && rxTimestamps[(written - 1) % sizeRxTimestamps].position == position) return;
+      rxTimestamps[written % sizeRxTimestamps] = _Timestamp{position, time};
+      rxStamped = written + 1;
+    }
+  }
+
+    // Elements in tx buffer may be sent by DMA till transfer is complete, so they are never overwritten:
+    // data, that doesn't fit, is dropped as a whole
+  static inline container::CircularBuffer<Type, txSize, container::overflow::Drop> txBuffer;
   static inline container::CircularBuffer<Type, rxSize> rxBuffer;
 
 };
@@ -0,0 +1,313 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Extraction of frames from rx buffer of connection
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _IFRAMER_HPP
+#define _IFRAMER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "../Common/Compiler/Compiler.h"
+#include "../../Containers/Span.hpp"
+
+/*!
+  @brief Controller's common interfaces
+*/
+namespace controller::interfaces{
+
+/*!
+  @brief Framing protocols. Each protocol is a state machine, that decodes one element per step
+*/
+namespace framing{
+
+/*!
+  @brief Result of one step of framing
+*/
+enum class step : uint8_t{
+  Skip,   // element is not part of frame data (header, escape, code)
+  Data,   // element is frame data
+  Last,   // element is the last frame data
+  End,    // element ends frame and is not part of frame data
+  Error,  // frame is broken, elements are skipped till end of frame
+  ErrorEnd // frame is broken and element ends it
+};
+
+/*!
+  @brief Frame ends with delimiter, e.g.: '\n'. Delimiter is not part of frame
+  @tparam <delimiter> value of delimiter
+*/
+template<auto delimiter>
+struct Delimiter{
+
+  static constexpr bool isDecoded = false;
+
+  template<typename T>
+  __FORCE_INLINE step Step(T& element){ return element == delimiter ? step::End : step::Data; }
+
+  __FORCE_INLINE void Reset(){}
+
+};
+
+/*!
+  @brief Frame starts with length of data in header
+  @tparam <sizeLength> number of elements in length field
+  @tparam <isBigEndian> byte order of length field
+*/
+template<size_t sizeLength = 1, bool isBigEndian = true>
+struct LengthPrefix{
+
+  static_assert(sizeLength && sizeLength <= sizeof(size_t), "Wrong size of length field");
+
+  static constexpr bool isDecoded = false;
+
+  template<typename T>
+  step Step(T& element){
+    if (index < sizeLength){
+      size_t value = static_cast<uint8_t>(element);
+      if constexpr (isBigEndian) remain = (remain << 8) | value;
+      else remain |= value << (8 * index);
+      return ++index == sizeLength && !remain ? step::End : step::Skip;
+    }
+    return --remain ? step::Data : step::Last;
+  }
+
+  __FORCE_INLINE void Reset(){ index = remain = 0; }
+
+private:
+
+  size_t index = 0;
+  size_t remain = 0;
+
+};
+
+/*!
+  @brief Consistent Overhead Byte Stuffing. Frame ends with zero, data has no zeros
+*/
+struct COBS{
+
+  static constexpr bool isDecoded = true;
+
+  template<typename T>
+  step Step(T& element){
+    if (!element) return remain ? step::ErrorEnd : step::End;
+    if (remain){
+      --remain;
+      return step::Data;
+    }
+      // Code of next block. Previous not full block ends with implicit zero
+    bool isZero = code && code != 0xFF;
+    code = static_cast<uint8_t>(element);
+    remain = code - 1;
+    if (!isZero) return step::Skip;
+    element = 0;
+    return step::Data;
+  }
+
+  __FORCE_INLINE void Reset(){ code = 0; remain = 0; }
+
+private:
+
+  uint8_t code = 0;
+  uint8_t remain = 0;
+
+};
+
+/*!
+  @brief Serial Line Internet Protocol, RFC 1055. Frame ends with END, END and ESC in data are escaped
+*/
+struct SLIP{
+
+  static constexpr bool isDecoded = true;
+
+  static constexpr uint8_t END = 0xC0;
+  static constexpr uint8_t ESC = 0xDB;
+  static constexpr uint8_t ESC_END = 0xDC;
+  static constexpr uint8_t ESC_ESC = 0xDD;
+
+  template<typename T>
+  step Step(T& element){
+    if (isEscape){
+      isEscape = false;
+      if (element == ESC_END) element = END;
+      else if (element == ESC_ESC) element = ESC;
+      else return step::Error;
+      return step::Data;
+    }
+    if (element == END) return step::End;
+    isEscape = element == ESC;
+    return isEscape ? step::Skip : step::Data;
+  }
+
+  __FORCE_INLINE void Reset(){ isEscape = false; }
+
+private:
+
+  bool isEscape = false;
+
+};
+
+} // !namespace framing
+
+/*!
+  @brief Extraction of frames from rx buffer of connection. Static class.
+    Each received element is scanned once: scan continues from the last position.
+    Frame is a view of rx buffer, no data is copied. Escaped protocols (COBS, SLIP) are decoded in place,
+    over already scanned elements. Frame is valid till Release or overflow of rx buffer. Empty frames are skipped
+  @tparam <connection> class with IConnection interface
+  @tparam <framing_> protocol from namespace framing
+  @tparam <maxSize> max number of data elements in frame. Should be less than size of rx buffer
+*/
+template<typename connection, typename framing_, size_t maxSize>
+class IFramer{
+
+  IFramer() = delete;
+
+  using type = typename connection::type;
+
+public:
+
+  /*!
+    @brief Frame: view of rx buffer. Elements are volatile, if rx buffer has volatile storage
+  */
+  using frame_t = decltype(connection::PeekRx());
+
+  /*!
+    @brief Scan received elements. Call from main loop or use Attach
+    @return true, if frame is ready
+  */
+  static bool Poll(){
+    _CheckOverflow();
+    if (isReady) return true;
+    auto data = connection::PeekRx();
+    size_t count = data.GetSize();
+    while (scanned < count){
+      type element = data[scanned++];
+      auto result = protocol.Step(element);
+      if (result == framing::step::Skip)
+        continue;
+      bool isEnd = result == framing::step::End || result == framing::step::Last || result == framing::step::ErrorEnd;
+      if (isSkipping){
+          // Rest of broken frame is dropped at once, so long garbage doesn't fill rx buffer
+        connection::ConsumeRx(scanned);
+        scanned = 0;
+        if (isEnd) _Reset();
+      } else if (result == framing::step::Error || result == framing::step::ErrorEnd ||
+                ((result == framing::step::Data || result == framing::step::Last) && decoded == maxSize)){
+        ++errors;
+        if (isEnd){
+          _Drop();
+        } else {
+          connection::ConsumeRx(scanned);
+          scanned = begin = decoded = 0;
+          isSkipping = true;
+        }
+      } else if (result == framing::step::End){
+        if (decoded) return isReady = true;
+        _Drop();
+      } else {
+        if (!decoded) begin = scanned - 1;
+        if constexpr (framing_::isDecoded)
+          const_cast<element_t&>(data[begin + decoded]) = element;
+        ++decoded;
+        if (result == framing::step::Last) return isReady = true;
+        continue;
+      }
+      data = connection::PeekRx();
+      count = data.GetSize();
+    }
+    return false;
+  }
+
+  /*!
+    @brief Get ready frame
+    @return up to two contiguous spans of frame data in rx buffer. Empty, if frame is not ready 
+      or lost on rx overflow
+  */
+  static frame_t GetFrame(){
+    if (_CheckOverflow() || !isReady) return {};
+    return connection::PeekRx().Slice(begin, decoded);
+  }
+
+  /*!
+    @brief Release ready frame: its elements are dropped from rx buffer
+  */
+  static void Release(){
+    if (_CheckOverflow() || !isReady) return;
+    _Drop();
+  }
+
+  /*!
+    @brief Extract frames on rx event of connection(IDLE line, DMA transfer).
+      Overrides CallbackRxNotEmpty of connection. Frame is released after callback
+    @param [in] callback called from ISR for each frame
+  */
+  static void Attach(void (*callback)(frame_t frame)){
+    callbackFrame = callback;
+    connection::CallbackRxNotEmpty = _OnRx;
+  }
+
+  /*!
+    @brief Get number of broken, too long or lost on rx overflow frames
+  */
+  __FORCE_INLINE static size_t GetErrors(){ return errors; }
+
+  /*!
+    @brief Reset counter of errors
+  */
+  __FORCE_INLINE static void ResetStatistics(){ errors = 0; }
+
+private:
+
+    // Writable element of rx buffer for decoding in place. Volatile qualifier is kept
+  using element_t = std::remove_const_t<std::remove_reference_t<decltype(std::declval<frame_t>()[0])>>;
+
+  static inline framing_ protocol;
+  static inline size_t scanned = 0;
+  static inline size_t begin = 0;
+  static inline size_t decoded = 0;
+  static inline size_t dropped = 0;
+  static inline size_t errors = 0;
+  static inline bool isReady = false;
+  static inline bool isSkipping = false;
+  static inline void (*callbackFrame)(frame_t) = nullptr;
+
+    // Drop scanned elements from rx buffer and start new frame
+  static void _Drop(){
+    connection::ConsumeRx(scanned);
+    _Reset();
+  }
+
+    // Rx buffer was overflowed: head is moved, so positions of frame are wrong and scan starts again from new head
+  static bool _CheckOverflow(){
+    auto value = connection::GetRxDropped();
+    if (value == dropped) return false;
+    dropped = value;
+    if (scanned || isReady || isSkipping) ++errors;
+    _Reset();
+    return true;
+  }
+
+  __FORCE_INLINE static void _Reset(){
+    scanned = begin = decoded = 0;
+    isReady = isSkipping = false;
+    protocol.Reset();
+  }
+
+  static void _OnRx(){
+    while (Poll()){
+      if (callbackFrame) callbackFrame(GetFrame());
+      Release();
+    }
+  }
+
+};
+
+} // !namespace controller::interfaces
+
+#endif // !_IFRAMER_HPP
@@ -24,6 +24,9 @@
   #if __has_include("Pinlist/stm32f1_Pinlist.hpp")
     #include "Pinlist/stm32f1_Pinlist.hpp"
   #endif
+  #if __has_include("DMA/stm32f1_DMA.hpp")
+    #include "DMA/stm32f1_DMA.hpp"
+  #endif
   #if __has_include("UART/stm32f1_UART.hpp")
     #include "UART/stm32f1_UART.hpp"
   #endif
@@ -18,8 +18,8 @@ namespace controller{
 
 /*!
   @brief  SPI1 interface
-  @tparam <txBufferSize> size of tx buffer
-  @tparam <txBufferSize> size of rx buffer
+  @tparam <txBufferSize> size of tx buffer in frames(8/16 bit elements)
+  @tparam <rxBufferSize> size of rx buffer in frames(8/16 bit elements)
   @tparam <comm> communication type: via DMA or ISR
   @tparam <divisor> baud rate control
   @tparam <remap> remap pins of SPI
@@ -75,8 +75,8 @@ protected:
 
 /*!
   @brief  SPI2 interface
-  @tparam <txBufferSize> size of tx buffer
-  @tparam <txBufferSize> size of rx buffer
+  @tparam <txBufferSize> size of tx buffer in frames(8/16 bit elements)
+  @tparam <rxBufferSize> size of rx buffer in frames(8/16 bit elements)
   @tparam <comm> communication type: via DMA or ISR
   @tparam <divisor> baud rate control
   @tparam <size> data frame format: 8/16 bit
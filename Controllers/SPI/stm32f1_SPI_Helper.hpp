@@ -9,6 +9,7 @@
 #ifndef _STM32F1_SPI_HELPER_HPP
 #define _STM32F1_SPI_HELPER_HPP
 
+#include <atomic>
 #include "../Common/Compiler/Compiler.h"
 #include "../Interfaces/IPower.hpp"
 #include "../Interfaces/IConnection.hpp"
@@ -17,6 +18,15 @@
 #include "../Pinlist/stm32f1_Pinlist.hpp"
 #include "../DMA/stm32f1_DMA.hpp"
 
+#ifndef SPI_TRANSACTION_QUEUE_SIZE
+  #define SPI_TRANSACTION_QUEUE_SIZE 8
+#endif
+
+  // Max frequency of SCK in master mode, Hz
+#ifndef SPI_FREQUENCY_LIMIT
+  #define SPI_FREQUENCY_LIMIT 18000000
+#endif
+
 /*!
   @brief Configuration for SPI
 */
@@ -116,8 +126,8 @@ using namespace controller::configuration::dma;
   @brief UART Driver for STM32F1 series. Don't use it Directly
   @tparam <adapter> spicific spi device
   @tparam <spiID> number of SPI
-  @tparam <txBufferSize> size of tx buffer
-  @tparam <txBufferSize> size of rx buffer
+  @tparam <txBufferSize> size of tx buffer in frames(8/16 bit elements)
+  @tparam <rxBufferSize> size of rx buffer in frames(8/16 bit elements)
   @tparam <comm> communication type: via DMA or ISR
   @tparam <divisor> baud rate control
   @tparam <remap> remap pins of SPI
@@ -130,13 +140,12 @@ template<typename adapter, uint32_t spiID, size_t txBufferSize, size_t rxBufferS
 class Helper: public IConnection<std::conditional_t<frame_size == frame_size::FRAME_8_BIT, uint8_t, uint16_t>, 
                      txBufferSize, rxBufferSize, controller::interface::SPI,
                      Helper<adapter, spiID, txBufferSize, rxBufferSize, comm, divisor, remap, frame_size, frame_format, mode>>, 
-              private controller::Clock{
+              private controller::hardware::Registers{
 
   using connection = IConnection<std::conditional_t<frame_size == frame_size::FRAME_8_BIT, uint8_t, uint16_t>, 
                      txBufferSize, rxBufferSize, controller::interface::SPI,
                      Helper<adapter, spiID, txBufferSize, rxBufferSize, comm, divisor, remap, frame_size, frame_format, mode>>;
 
-
   struct dma{
     using tx = controller::DMA<adapter::dmaID, adapter::channelDMATX>;
     using rx = controller::DMA<adapter::dmaID, adapter::channelDMARX>;
@@ -145,10 +154,10 @@ class Helper: public IConnection<std::conditional_t<frame_size == frame_size::FR
   struct address{
     static constexpr uint32_t
       base = adapter::baseAddress,
-      CR1 = addressBase,
-      CR2 = addressBase + 4,
-      SR = addressBase + 8,
-      DR = addressBase + 12;
+      CR1 = base,
+      CR2 = base + 4,
+      SR = base + 8,
+      DR = base + 12;
   };
 
   struct mask{
@@ -167,7 +176,8 @@ class Helper: public IConnection<std::conditional_t<frame_size == frame_size::FR
         SPE = 1 << 6, // SPI enable
         MSTR = 1 << 2, // Master selection
         SSI = 1 << 8, // Internal slave select
-        SSM = 1 << 9; // Sofrware slave managment
+        SSM = 1 << 9, // Sofrware slave managment
+        BR = 7 << 3; // Baud rate control
     };
     struct CR2{
       static constexpr uint32_t
@@ -189,27 +199,81 @@ class Helper: public IConnection<std::conditional_t<frame_size == frame_size::FR
 
 public:
 
+  using type = typename connection::type;
+
   /*!
     @brief Initialization of SPI
   */  
-  static void Init(){
-    Registers::_Write<address::CR2, valueCR2>();
-    Registers::_Write<address::CR1, valueCR1>();
+  static void Init(){ _Init<valueCR1>(); }
 
-    if constexpr (isRXDMA || isTXDMA){
-      if constexpr(isRXDMA){
-        dma::rx::template SetPeripheral<address::DR>();
-        dma::rx::template Init<false, minc::MINC_Enabled, pinc::PINC_Disabled,
-                               dir::DIR_ToMemory, circ::CIRC_Disabled, isr::ISR_TC>();
-      }
-      if constexpr(isTXDMA){
-        dma::tx::template SetPeripheral<address::DR>();
-        dma::tx::template Init<false, minc::MINC_Enabled, pinc::PINC_Disabled,
-                               dir::DIR_ToPeripheral, circ::CIRC_Disabled, isr::ISR_TC>();
-      }
+  /*!
+    @brief Initialization of SPI with the fastest divisor for frequency. Divisor is computed at compile time,
+      template divisor is ignored
+    @tparam <maxHz> max frequency of SCK. Limited by SPI_FREQUENCY_LIMIT
+    @tparam <clock> clock tree. Should be the same as in Clock::Set
+  */
+  template<uint32_t maxHz, typename clock = controller::Clock::Tree<>>
+  static void Init(){ _Init<(valueCR1 & ~mask::CR1::BR) | _CalculateBR<maxHz, clock>()>(); }
+
+  /*!
+    @brief Set the fastest divisor for frequency. Call, when transfer is not in progress
+    @tparam <maxHz> max frequency of SCK. Limited by SPI_FREQUENCY_LIMIT
+    @tparam <clock> clock tree. Should be the same as in Clock::Set
+  */
+  template<uint32_t maxHz, typename clock = controller::Clock::Tree<>>
+  __FORCE_INLINE static void SetFrequency(){
+    Registers::_Set<address::CR1, _CalculateBR<maxHz, clock>(), mask::CR1::BR>();
+  }
+
+  /*!
+    @brief Get actual frequency of SCK for max one. Frequency, that can't be set, is rejected as in SetFrequency
+    @tparam <maxHz> max frequency of SCK
+    @tparam <clock> clock tree
+  */
+  template<uint32_t maxHz, typename clock = controller::Clock::Tree<>>
+  static constexpr uint32_t GetFrequency(){
+    return valueClock<clock> >> ((_CalculateBR<maxHz, clock>() >> 3) + 1);
+  }
+
+  /*!
+    @brief Queue transaction with chip select. Transactions are chained in DMA RX Handler without main loop:
+      CS is asserted, data is exchanged, CS is released and callback is called, then the next transaction starts.
+      Transaction waits for the end of stream of connection(Write/Read), stream continues after queue is empty.
+      Write-only and read-only transactions use no buffer: dummy element is sent or received data is discarded
+      by DMA without memory increment. Data should stay valid till callback
+    @tparam <pinCS> pin of chip select, active low. void - CS is not used
+    @param [in] tx data to send. Not more than 65535 elements. Empty - dummy element is sent rx.size times
+    @param [in] rx buffer for received data, not less than tx. Empty - received data is discarded
+    @param [in] callback called from DMA RX Handler after CS is released
+    @return false, if queue is full or size is wrong
+  */
+  template<typename pinCS = void>
+  static bool Transaction(container::Span<const type> tx, container::Span<type> rx = {}, void (*callback)() = nullptr){
+    static_assert(isTXDMA && isRXDMA, "Transaction requires TX and RX via DMA");
+    size_t size = tx.data ? tx.size : rx.size;
+    if (!size || size > 0xFFFF || (rx.data && rx.size < size)) return false;
+    void (*select)() = nullptr;
+    void (*deselect)() = nullptr;
+    if constexpr (!std::is_void_v<pinCS>){
+      select = pinCS::Low;
+      deselect = pinCS::High;
     }
+    if (!transactions.Push(transaction{select, deselect, tx.data, rx.data, size, callback})) return false;
+    _DispatchTransaction();
+    return true;
   }
 
+  /*!
+    @brief Set element sent by read-only transactions, e.g.: 0xFF for flash memory
+    @param [in] value of dummy element
+  */
+  __FORCE_INLINE static void SetDummy(type value){ dummyTX = value; }
+
+  /*!
+    @brief Check that transaction is in progress or queued
+  */
+  __FORCE_INLINE static bool IsTransactionBusy(){ return isTransaction || isDispatching || !transactions.IsEmpty(); }
+
   __FORCE_INLINE static void SetCountSendAtOnce(size_t count){
     countToSend = countToSendCurrent = count;
   };
@@ -218,14 +282,18 @@ public:
     @brief Interrupt Handler for TX via DMA
   */ 
   __FORCE_INLINE static void ISR_DMA_TX(){
+      // Request of finished transaction, flags were cleared in DMA RX Handler
+    if (!dma::tx::IsTransferComplete()) return;
     dma::tx::ClearFlags();
+    if (isTransaction) return;
     dma::tx::Disable();
-    if (connection::txBuffer.IsEmpty()){
-      if (connection::CallbackIdleTX)
-        connection::CallbackIdleTX();
-    }
+    connection::txBuffer.AddToHead(countTxDMA);
+    countTxDMA = 0;
+    if (connection::txBuffer.IsEmpty())
+      connection::_NotifyIdleTx();
     else if (!countToSend)
       _EnableTxDMA(); 
+    _DispatchTransaction();
   }
 
   /*!
@@ -234,18 +302,23 @@ public:
   __FORCE_INLINE static void ISR_DMA_RX(){
     dma::rx::ClearFlags();
     dma::rx::Disable();
+    if (isTransaction){
+      _CompleteTransaction();
+      return;
+    }
     connection::rxBuffer.AddToTail(countToAddRX);
     if (countRX){
       _EnableRxDMA();
     }
-    else if (connection::CallbackRxNotEmpty && (!countToSend || (countToSend && !countToSendCurrent))){
+    else if (connection::_IsRxNotified() && (!countToSend || (countToSend && !countToSendCurrent))){
       countToSendCurrent = countToSend; 
-      connection::CallbackRxNotEmpty();
+      connection::_NotifyRx();
     }
     if (countToSend && !connection::txBuffer.IsEmpty()){
       if constexpr (isTXDMA) _EnableTxDMA(); 
       else Registers::_Set<address::CR2, mask::CR2::TXEIE>();
     }
+    _DispatchTransaction();
   }
 
   /*!
@@ -267,8 +340,7 @@ public:
         }
         else {
           Registers::_Clear<address::CR2, mask::CR2::TXEIE>();
-          if (connection::CallbackIdleTX)
-            connection::CallbackIdleTX();
+          connection::_NotifyIdleTx();
         }
       }
     }
@@ -277,9 +349,9 @@ public:
       if (valueSR & mask::SR::RXNE){
         connection::rxBuffer.Push(valueDR);
         if (!Registers::_Read<address::SR, mask::SR::BSY>()){
-          if (connection::CallbackRxNotEmpty && (!countToSend || (countToSend && !countToSendCurrent))){
+          if (connection::_IsRxNotified() && (!countToSend || (countToSend && !countToSendCurrent))){
             countToSendCurrent = countToSend;
-            connection::CallbackRxNotEmpty();
+            connection::_NotifyRx();
           }
           if (countToSend && !connection::txBuffer.IsEmpty()){
             if constexpr (isTXDMA) _EnableTxDMA();
@@ -328,6 +400,43 @@ protected:
   static inline uint32_t valueSR = 0;
   static inline uint32_t countRX = 0;
   static inline uint32_t countToAddRX = 0;
+  static inline size_t countTxDMA = 0;
+
+    // Transaction with chip select. tx - nullptr, if dummy is sent. rx - nullptr, if received data is discarded
+  struct transaction{
+    void (*select)();
+    void (*deselect)();
+    const type* tx;
+    type* rx;
+    size_t size;
+    void (*callback)();
+  };
+
+  static inline container::CircularBuffer<transaction, SPI_TRANSACTION_QUEUE_SIZE, 
+                                          container::overflow::Drop, container::storage::Atomic> transactions;
+  static inline transaction current;
+  static inline std::atomic<bool> isTransaction = false;
+  static inline std::atomic<bool> isDispatching = false;
+  static inline bool isStreamHeld = false;
+  static inline type sinkRX;
+  static inline type dummyTX = static_cast<type>(~0U);
+
+  template<uint32_t cr1>
+  static void _Init(){
+    Registers::_Write<address::CR2, valueCR2>();
+    Registers::_Write<address::CR1, cr1>();
+
+    if constexpr (isRXDMA || isTXDMA){
+      if constexpr(isRXDMA){
+        dma::rx::template SetPeripheral<address::DR>();
+        dma::rx::SetConfig(valueConfigRX);
+      }
+      if constexpr(isTXDMA){
+        dma::tx::template SetPeripheral<address::DR>();
+        dma::tx::SetConfig(valueConfigTX);
+      }
+    }
+  }
 
   __FORCE_INLINE static void _Send(){
     if constexpr(!isTXDMA) 
@@ -339,9 +448,16 @@ protected:
 
   __FORCE_INLINE static void _CheckRxBuffer(){ }
 
+    // Head of tx buffer is moved after transfer, so data being sent is not overwritten.
+    // Stream is held during dispatch of transaction and resumed by dispatcher
   static void _EnableTxDMA(){
-    if (dma::tx::IsEnabled()) return;
-    auto address = reinterpret_cast<uint32_t>(connection::txBuffer.GetHeadAddress());
+    if (isTransaction) return;
+    if (isDispatching){
+      isStreamHeld = true;
+      return;
+    }
+    if (dma::tx::IsEnabled() || connection::txBuffer.IsEmpty()) return;
+    auto address = connection::txBuffer.GetHeadAddress();
     auto count = connection::txBuffer.GetCountToBufferLastIndex();
     if (countToSend){
       if (!countToSendCurrent) countToSendCurrent = countToSend;
@@ -357,13 +473,18 @@ protected:
     }
     dma::tx::SetCount(count);
     dma::tx::SetMemory(address);
-    connection::txBuffer.AddToHead(count);
+    countTxDMA = count;
     dma::tx::Enable();
   }
 
   static void _EnableRxDMA(){
+    if (isTransaction) return;
+    if (isDispatching){
+      isStreamHeld = true;
+      return;
+    }
     if (dma::rx::IsEnabled()) return; 
-    auto address = reinterpret_cast<uint32_t>(connection::rxBuffer.GetTailAddress());
+    auto address = connection::rxBuffer.GetTailAddress();
     countToAddRX = connection::rxBuffer.GetCountToBuffersEnd();
     countToAddRX = countRX > countToAddRX ? countToAddRX : countRX;
     countRX -= countToAddRX;
@@ -372,6 +493,63 @@ protected:
     dma::rx::Enable();
   }
 
+    // Owner of dispatch flag starts transaction, the next ones are started by completion of current.
+    // Transaction flag is set only, when transaction owns DMA, so handlers of stream are not confused by dispatch.
+    // Queue is checked again after release, so transaction queued during release is not lost
+  static void _DispatchTransaction(){
+    if constexpr (isTXDMA && isRXDMA){
+      while (!transactions.IsEmpty() && !isDispatching.exchange(true, std::memory_order_acquire)){
+        bool isStarted = _IsIdle() && _StartTransaction();
+        isDispatching.store(false, std::memory_order_release);
+          // Running stream dispatches queue after its end
+        if (isStarted || !_IsIdle()) return;
+      }
+      if (isStreamHeld && _IsIdle()) _ResumeStream();
+    }
+  }
+
+  __FORCE_INLINE static bool _IsIdle(){
+    return !isTransaction && !dma::tx::IsEnabled() && !dma::rx::IsEnabled();
+  }
+
+  static void _ResumeStream(){
+    isStreamHeld = false;
+    if (!connection::txBuffer.IsEmpty()) _Send();
+    else if (countRX) _EnableRxDMA();
+  }
+
+  static bool _StartTransaction(){
+    if (transactions.IsEmpty()) return false;
+    isTransaction.store(true, std::memory_order_relaxed);
+    current = transactions.Pop();
+    if (current.select) current.select();
+    dma::rx::SetConfig(current.rx ? valueConfigRX : valueConfigSink);
+    dma::rx::SetMemory(current.rx ? current.rx : &sinkRX);
+    dma::rx::SetCount(current.size);
+    dma::tx::SetConfig(current.tx ? valueConfigTX : valueConfigSource);
+    dma::tx::SetMemory(current.tx ? current.tx : &dummyTX);
+    dma::tx::SetCount(current.size);
+    dma::rx::ClearFlags();
+    dma::tx::ClearFlags();
+    dma::rx::Enable();
+    dma::tx::Enable();
+    return true;
+  }
+
+    // RX is complete after TX, so CS is released after the last clock
+  static void _CompleteTransaction(){
+    dma::tx::Disable();
+    dma::tx::ClearFlags();
+    if (current.deselect) current.deselect();
+    if (current.callback) current.callback();
+    if (_StartTransaction()) return;
+    dma::rx::SetConfig(valueConfigRX);
+    dma::tx::SetConfig(valueConfigTX);
+    isTransaction.store(false, std::memory_order_release);
+    _DispatchTransaction();
+    if (_IsIdle()) _ResumeStream();
+  }
+
   static constexpr uint32_t valueCR1 = mask::CR1::SPE  | // Enable SPI
                                        mask::CR1::SSM  | // Enable software slave managment 
                                        mask::CR1::SSI  | // Force slave select to active
@@ -384,11 +562,54 @@ protected:
   static constexpr uint32_t valueCR2 = mask::CR2::ERRIE  | // Enable Error interrupt 
                                        (uint32_t)comm;// Set polarity and Phase
 
+  template<typename clock>
+  static constexpr uint32_t valueClock = spiID == 1 ? clock::valueAPB2 : clock::valueAPB1;
+
+    // Index of the smallest divisor 2^(index + 1), that gives frequency not more than max one. 8 - no divisor
+  static constexpr uint32_t _GetIndexBR(uint32_t clock, uint32_t maxHz){
+    uint32_t frequency = maxHz < SPI_FREQUENCY_LIMIT ? maxHz : SPI_FREQUENCY_LIMIT;
+    uint32_t index = 0;
+    while (index < 8 && (clock >> (index + 1)) > frequency) ++index;
+    return index;
+  }
+
+  template<uint32_t maxHz, typename clock>
+  static constexpr uint32_t valueBR = _GetIndexBR(valueClock<clock>, maxHz);
+
+  template<uint32_t maxHz, typename clock>
+  static constexpr uint32_t _CalculateBR(){
+    static_assert(valueBR<maxHz, clock> < 8, "Frequency of SPI is too low for clock of bus");
+    return valueBR<maxHz, clock> << 3;
+  }
+
+    // DMA transfers one frame per request: 16-bit frames halve number of requests
+  static constexpr data_size valueDataSize = sizeof(type) == 2 ? data_size::Size_16 : data_size::Size_8;
+
+  static constexpr uint32_t valueConfigRX = dma::rx::template valueConfig<minc::MINC_Enabled, pinc::PINC_Disabled,
+                                            dir::DIR_ToMemory, circ::CIRC_Disabled, isr::ISR_TC,
+                                            valueDataSize, valueDataSize, priority::High>;
+
+    // Received data of transaction is discarded to one element
+  static constexpr uint32_t valueConfigSink = dma::rx::template valueConfig<minc::MINC_Disabled, pinc::PINC_Disabled,
+                                              dir::DIR_ToMemory, circ::CIRC_Disabled, isr::ISR_TC,
+                                              valueDataSize, valueDataSize, priority::High>;
+
+  static constexpr uint32_t valueConfigTX = dma::tx::template valueConfig<minc::MINC_Enabled, pinc::PINC_Disabled,
+                                            dir::DIR_ToPeripheral, circ::CIRC_Disabled, isr::ISR_TC,
+                                            valueDataSize, valueDataSize, priority::Medium>;
+
+    // Dummy element of read-only transaction is sent from one element
+  static constexpr uint32_t valueConfigSource = dma::tx::template valueConfig<minc::MINC_Disabled, pinc::PINC_Disabled,
+                                                dir::DIR_ToPeripheral, circ::CIRC_Disabled, isr::ISR_TC,
+                                                valueDataSize, valueDataSize, priority::Medium>;
+
   template<typename>
   friend class controller::interfaces::IPower;
 
   friend controller::Interrupt;
 
+  friend controller::DMAManager;
+
   template<typename...>
   friend class helper::pinlist::Helper;
 
@@ -415,6 +636,7 @@ protected:
     using power = typename controller::Power::fromPeripherals<powerSPI, MOSI, MISO, CLCK>::power;
     using pins = trait::Typelist<MOSI, MISO, CLCK>;
     using interrupts = trait::remove_value_t<0,trait::Valuelist<adapter::irq::SPI, irqnDMATX, irqnDMARX>>;
+    using channelsDMA = trait::remove_value_t<0,trait::Valuelist<isTXDMA ? dma::tx::id : 0, isRXDMA ? dma::rx::id : 0>>;
   };
 
 };
@@ -0,0 +1,353 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Simulated SPI and DMA with throughput counters. STM32F1-series. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _STM32F1_SPI_SIMULATION_HPP
+#define _STM32F1_SPI_SIMULATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "../Common/Core/Registers_Simulation.hpp"
+#if defined(REGISTERS_TRACE)
+  #include "../Common/Core/Registers_Trace.hpp"
+#endif
+
+/*!
+  @brief Simulation of controller's hardware on host
+*/
+namespace controller::hardware::simulation{
+
+/*!
+  @brief Model of SPI master with DMA channels for comparison of communication modes.
+    One Step is time of one frame on the line: frame of DR is exchanged with device,
+    DMA serves one request per channel, handlers of raised interrupts are called.
+    Statistics give interrupts per transfer and, with REGISTERS_TRACE, register accesses and bus cycles
+    spent in handlers. Used with REGISTERS_SIMULATION: DMA reaches buffers by bus addresses of Memory.
+    E.g.: Attach(0x40013000, 0x40020000, 3, 2, {SPI::ISR, SPI::ISR_DMA_TX, SPI::ISR_DMA_RX});
+          SPI::Init(); SPI::Write(data, size); auto statistics = Run();
+*/
+class SPIModel{
+
+public:
+
+  SPIModel() = delete;
+
+  /*!
+    @brief Handlers of SPI and its DMA channels. nullptr - handler is not used
+  */
+  struct Handlers{
+    void (*ISR)();
+    void (*ISR_DMA_TX)();
+    void (*ISR_DMA_RX)();
+  };
+
+  /*!
+    @brief Counters since Attach or ResetStatistics
+  */
+  struct Statistics{
+    /*! @brief Number of steps(frame times) of Run*/
+    size_t steps;
+    /*! @brief Number of exchanged frames*/
+    size_t frames;
+    /*! @brief Number of frames lost because of not read DR*/
+    size_t overruns;
+    /*! @brief Number of calls of SPI handler*/
+    size_t interruptsSPI;
+    /*! @brief Number of calls of DMA TX handler*/
+    size_t interruptsDMATX;
+    /*! @brief Number of calls of DMA RX handler*/
+    size_t interruptsDMARX;
+    /*! @brief Number of register accesses in handlers. Requires REGISTERS_TRACE*/
+    size_t accessesISR;
+    /*! @brief Number of bus cycles of register accesses in handlers. Requires REGISTERS_TRACE*/
+    size_t busCyclesISR;
+
+    /*!
+      @brief Get number of calls of all handlers
+    */
+    __FORCE_INLINE size_t GetInterrupts() const { return interruptsSPI + interruptsDMATX + interruptsDMARX; }
+  };
+
+  /*!
+    @brief Connect SPI and its DMA channels. Registers are set to reset values, statistics are reset
+    @param [in] base address of SPI
+    @param [in] baseDMA address of DMA
+    @param [in] channelTX number of DMA TX channel
+    @param [in] channelRX number of DMA RX channel
+    @param [in] handlers of interrupts
+    @param [in] device returns frame of slave for received one. nullptr - MISO is connected to MOSI
+  */
+  static void Attach(uint32_t base, uint32_t baseDMA, uint8_t channelTX, uint8_t channelRX,
+                     Handlers handlers, uint16_t (*device)(uint16_t) = nullptr){
+    spi = base;
+    dma = baseDMA;
+    channels[tx] = Channel{channelTX, false, 0, 0, 0};
+    channels[rx] = Channel{channelRX, false, 0, 0, 0};
+    SPIModel::handlers = handlers;
+    SPIModel::device = device;
+    isPending = false;
+    frameRX = 0;
+    Memory::Configure(spi + offsetCR1, 0, 0, 0, 0, 0, 0xFFFF0000);
+    Memory::Configure(spi + offsetCR2, 0, 0, 0, 0, 0, 0xFFFFFF18);
+    Memory::Configure(spi + offsetSR, maskSR::TXE, 0, maskSR::CRCERR, 0,
+                      maskSR::TXE | maskSR::RXNE | maskSR::BSY | maskSR::OVR, 0xFFFFFF00);
+    auto& dr = Memory::Configure(spi + offsetDR, 0, 0, 0, 0, 0, 0xFFFF0000);
+    dr.CallbackRead = _ReadDR;
+    dr.CallbackWrite = _WriteDR;
+    Memory::Configure(dma + offsetISR, 0, 0, 0, 0, 0xFFFFFFFF, 0xF0000000);
+    Memory::Configure(dma + offsetIFCR, 0, 0, 0, 0, 0, 0xF0000000).CallbackWrite = _WriteIFCR;
+    for (auto& channel : channels){
+      Memory::Configure(_GetAddressCCR(channel), 0, 0, 0, 0, 0, 0xFFFF8000).CallbackWrite = _WriteCCR;
+      Memory::Configure(_GetAddressCCR(channel) + offsetCNDTR, 0, 0, 0, 0, 0, 0xFFFF0000);
+      Memory::Configure(_GetAddressCCR(channel) + offsetCPAR);
+      Memory::Configure(_GetAddressCCR(channel) + offsetCMAR);
+    }
+    ResetStatistics();
+  }
+
+  /*!
+    @brief Simulate time of one frame
+    @return false, if nothing happened: line, DMA and handlers are idle
+  */
+  static bool Step(){
+    bool isActive = _Shift();
+    isActive |= _ServeDMA(channels[rx]);
+    isActive |= _ServeDMA(channels[tx]);
+    isActive |= _Interrupts();
+    statistics.steps++;
+    return isActive;
+  }
+
+  /*!
+    @brief Simulate till SPI, DMA and handlers are idle
+    @param [in] maxSteps limit of steps, e.g.: transfer never ends
+    @return statistics since Attach or ResetStatistics
+  */
+  static const Statistics& Run(size_t maxSteps = 1000000){
+    while (maxSteps-- && Step()){}
+    return statistics;
+  }
+
+  /*!
+    @brief Get statistics since Attach or ResetStatistics
+  */
+  __FORCE_INLINE static const Statistics& GetStatistics(){ return statistics; }
+
+  /*!
+    @brief Reset statistics
+  */
+  static void ResetStatistics(){ statistics = Statistics{}; }
+
+private:
+
+  static constexpr uint32_t offsetCR1 = 0;
+  static constexpr uint32_t offsetCR2 = 4;
+  static constexpr uint32_t offsetSR = 8;
+  static constexpr uint32_t offsetDR = 12;
+
+  static constexpr uint32_t offsetISR = 0;
+  static constexpr uint32_t offsetIFCR = 4;
+  static constexpr uint32_t offsetCCR = 8;
+  static constexpr uint32_t offsetCNDTR = 4;
+  static constexpr uint32_t offsetCPAR = 8;
+  static constexpr uint32_t offsetCMAR = 12;
+
+  struct maskSR{
+    static constexpr uint32_t
+      BSY = 1 << 7,
+      OVR = 1 << 6,
+      CRCERR = 1 << 4,
+      TXE = 1 << 1,
+      RXNE = 1 << 0;
+  };
+
+  struct maskCR1{
+    static constexpr uint32_t
+      DFF = 1 << 11,
+      SPE = 1 << 6;
+  };
+
+  struct maskCR2{
+    static constexpr uint32_t
+      TXEIE = 1 << 7,
+      RXNEIE = 1 << 6,
+      ERRIE = 1 << 5,
+      TXDMAEN = 1 << 1,
+      RXDMAEN = 1 << 0;
+  };
+
+  struct maskCCR{
+    static constexpr uint32_t
+      EN = 1,
+      TCIE = 1 << 1,
+      HTIE = 1 << 2,
+      DIR = 1 << 4,
+      CIRC = 1 << 5,
+      MINC = 1 << 7;
+    static constexpr uint32_t shiftMSIZE = 10;
+  };
+
+    // Internal state of channel: address and count are latched on enable
+  struct Channel{
+    uint8_t number;
+    bool isEnabled;
+    uint32_t memory;
+    uint32_t count;
+    uint32_t reload;
+  };
+
+  static constexpr size_t tx = 0;
+  static constexpr size_t rx = 1;
+
+  static inline uint32_t spi = 0;
+  static inline uint32_t dma = 0;
+  static inline Channel channels[2] {};
+  static inline Handlers handlers {};
+  static inline uint16_t (*device)(uint16_t) = nullptr;
+  static inline uint16_t frameTX = 0;
+  static inline uint16_t frameRX = 0;
+  static inline bool isPending = false;
+  static inline Statistics statistics {};
+
+  __FORCE_INLINE static uint32_t _GetAddressCCR(const Channel& channel){
+    return dma + offsetCCR + 20*(channel.number - 1);
+  }
+
+  __FORCE_INLINE static uint32_t _GetMaskFlags(const Channel& channel){ return 0xFU << 4*(channel.number - 1); }
+
+    // Write to DR loads transmit buffer. Read of DR returns receive buffer, so written value is replaced
+  static void _WriteDR(uint32_t, uint32_t value){
+    frameTX = static_cast<uint16_t>(value);
+    isPending = true;
+    Memory::Set(spi + offsetDR, frameRX);
+    Memory::Set(spi + offsetSR, Memory::Get(spi + offsetSR) & ~maskSR::TXE);
+  }
+
+    // Read of DR clears RXNE. Overrun is cleared by read of SR and DR, SR is read by handler before DR
+  static void _ReadDR(uint32_t, uint32_t){
+    Memory::Set(spi + offsetSR, Memory::Get(spi + offsetSR) & ~(maskSR::RXNE | maskSR::OVR));
+  }
+
+  static void _WriteIFCR(uint32_t, uint32_t value){
+    Memory::Set(dma + offsetISR, Memory::Get(dma + offsetISR) & ~value);
+  }
+
+  static void _WriteCCR(uint32_t address, uint32_t value){
+    for (auto& channel : channels){
+      if (_GetAddressCCR(channel) != address) continue;
+      bool isEnabled = value & maskCCR::EN;
+      if (isEnabled && !channel.isEnabled){
+        channel.memory = Memory::Get(address + offsetCMAR);
+        channel.count = channel.reload = Memory::Get(address + offsetCNDTR);
+      }
+      channel.isEnabled = isEnabled;
+    }
+  }
+
+    // Frame of transmit buffer is exchanged with device
+  static bool _Shift(){
+    uint32_t cr1 = Memory::Get(spi + offsetCR1);
+    if (!isPending || !(cr1 & maskCR1::SPE)) return false;
+    isPending = false;
+    uint16_t frame = cr1 & maskCR1::DFF ? frameTX : frameTX & 0xFF;
+    uint16_t response = device ? device(frame) : frame;
+    uint32_t sr = Memory::Get(spi + offsetSR) | maskSR::TXE;
+    statistics.frames++;
+    if (sr & maskSR::RXNE){
+      statistics.overruns++;
+      sr |= maskSR::OVR;
+    } else {
+      frameRX = cr1 & maskCR1::DFF ? response : response & 0xFF;
+      Memory::Set(spi + offsetDR, frameRX);
+      sr |= maskSR::RXNE;
+    }
+    Memory::Set(spi + offsetSR, sr);
+    return true;
+  }
+
+    // One request of peripheral per step. Transfers with DR have side-effects of core's access
+  static bool _ServeDMA(Channel& channel){
+    uint32_t ccr = Memory::Get(_GetAddressCCR(channel));
+    uint32_t cr2 = Memory::Get(spi + offsetCR2);
+    uint32_t sr = Memory::Get(spi + offsetSR);
+    bool isTX = &channel == &channels[tx];
+    bool isRequest = isTX ? (cr2 & maskCR2::TXDMAEN) && (sr & maskSR::TXE) && !isPending :
+                            (cr2 & maskCR2::RXDMAEN) && (sr & maskSR::RXNE);
+    if (!(ccr & maskCCR::EN) || !channel.count || !isRequest) return false;
+    size_t size = size_t(1) << ((ccr >> maskCCR::shiftMSIZE) & 3);
+    void* memory = Memory::GetPointer(channel.memory);
+    uint32_t value = 0;
+    if (ccr & maskCCR::DIR){
+      std::memcpy(&value, memory, size);
+      Memory::Write(spi + offsetDR, value);
+    } else {
+      value = Memory::Read(spi + offsetDR);
+      std::memcpy(memory, &value, size);
+    }
+    if (ccr & maskCCR::MINC) channel.memory += size;
+    channel.count--;
+    uint32_t shift = 4*(channel.number - 1);
+    uint32_t flags = 0;
+    if (channel.count == channel.reload / 2) flags |= 1U << (shift + 2);
+    if (!channel.count){
+      flags |= 1U << (shift + 1);
+      if (ccr & maskCCR::CIRC){
+        channel.memory = Memory::Get(_GetAddressCCR(channel) + offsetCMAR);
+        channel.count = channel.reload;
+      }
+    }
+    Memory::Set(_GetAddressCCR(channel) + offsetCNDTR, channel.count);
+    if (flags) Memory::Set(dma + offsetISR, Memory::Get(dma + offsetISR) | flags | (1U << shift));
+    return true;
+  }
+
+  static bool _Interrupts(){
+    bool isCalled = false;
+    uint32_t flags = Memory::Get(dma + offsetISR);
+    for (auto& channel : channels){
+      uint32_t ccr = Memory::Get(_GetAddressCCR(channel));
+      uint32_t enabled = ((ccr & (maskCCR::TCIE | maskCCR::HTIE)) << 4*(channel.number - 1));
+      if (!(flags & enabled & _GetMaskFlags(channel))) continue;
+      bool isTX = &channel == &channels[tx];
+      auto handler = isTX ? handlers.ISR_DMA_TX : handlers.ISR_DMA_RX;
+      if (!handler) continue;
+      (isTX ? statistics.interruptsDMATX : statistics.interruptsDMARX)++;
+      _Call(handler);
+      isCalled = true;
+    }
+    uint32_t cr2 = Memory::Get(spi + offsetCR2);
+    uint32_t sr = Memory::Get(spi + offsetSR);
+    bool isRaised = ((cr2 & maskCR2::TXEIE) && (sr & maskSR::TXE) && !isPending) ||
+                    ((cr2 & maskCR2::RXNEIE) && (sr & maskSR::RXNE)) ||
+                    ((cr2 & maskCR2::ERRIE) && (sr & maskSR::OVR));
+    if (isRaised && handlers.ISR){
+      statistics.interruptsSPI++;
+      _Call(handlers.ISR);
+      isCalled = true;
+    }
+    return isCalled;
+  }
+
+    // Register accesses of handler are counted by trace
+  static void _Call(void (*handler)()){
+#if defined(REGISTERS_TRACE)
+    size_t accesses = trace::Trace::GetCount();
+    uint32_t cycles = trace::Trace::GetBusCycles();
+    handler();
+    statistics.accessesISR += trace::Trace::GetCount() - accesses;
+    statistics.busCyclesISR += trace::Trace::GetBusCycles() - cycles;
+#else
+    handler();
+#endif
+  }
+
+};
+
+} // !namespace controller::hardware::simulation
+
+#endif // !_STM32F1_SPI_SIMULATION_HPP
@@ -23,17 +23,20 @@ namespace controller{
   @tparam <comm> communication type - via DMA or ISR. Default TX and RX via DMA
   @tparam <mode> default mode is none parity, 8 data-bits, 1 stop-bit
   @tparam <remap> remap pins of UART
+  @tparam <pinDE> driver enable pin of RS-485 transceiver: high while transmitting. void - no pin
+  @tparam <guardDE> time in bits between end of transmission and release of DE. Rounded up to whole idle frames
 */  
 template<size_t txBufferSize, size_t rxBufferSize, 
          configuration::uart::communication comm = configuration::uart::communication::txDMA_rxDMA,
          configuration::uart::mode mode = configuration::uart::mode::E_8_1, 
-         configuration::uart::remap remap = configuration::uart::remap::None>
-class UART1 : public helper::uart::Helper<UART1<txBufferSize, rxBufferSize, comm, mode, remap>, 
-                          1, txBufferSize, rxBufferSize, comm, mode, remap>{
+         configuration::uart::remap remap = configuration::uart::remap::None,
+         typename pinDE = void, uint8_t guardDE = 0>
+class UART1 : public helper::uart::Helper<UART1<txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>, 
+                          1, txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>{
 protected:
 
-  using base = helper::uart::Helper<UART1<txBufferSize, rxBufferSize, comm, mode, remap>,
-                    1, txBufferSize, rxBufferSize, comm, mode, remap>;
+  using base = helper::uart::Helper<UART1<txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>,
+                    1, txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>;
 
   static constexpr uint32_t remapValue = remap == configuration::uart::remap::None ? 0 : 0x211;
 
@@ -75,17 +78,20 @@ protected:
   @tparam <comm> communication type - via DMA or ISR. Default TX and RX via DMA
   @tparam <mode> default mode is none parity, 8 data-bits, 1 stop-bit
   @tparam <remap> remap pins of UART
+  @tparam <pinDE> driver enable pin of RS-485 transceiver: high while transmitting. void - no pin
+  @tparam <guardDE> time in bits between end of transmission and release of DE. Rounded up to whole idle frames
 */ 
 template<size_t txBufferSize, size_t rxBufferSize, 
          configuration::uart::communication comm = configuration::uart::communication::txDMA_rxDMA,
          configuration::uart::mode mode = configuration::uart::mode::N_8_1, 
-         configuration::uart::remap remap = configuration::uart::remap::None>
-class UART2 : public helper::uart::Helper<UART2<txBufferSize, rxBufferSize, comm, mode, remap>, 
-                          2, txBufferSize, rxBufferSize, comm, mode, remap>{
+         configuration::uart::remap remap = configuration::uart::remap::None,
+         typename pinDE = void, uint8_t guardDE = 0>
+class UART2 : public helper::uart::Helper<UART2<txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>, 
+                          2, txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>{
 protected:
 
-  using base = helper::uart::Helper<UART2<txBufferSize, rxBufferSize, comm, mode, remap>,
-                    2, txBufferSize, rxBufferSize, comm, mode, remap>;
+  using base = helper::uart::Helper<UART2<txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>,
+                    2, txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>;
 
   static constexpr uint32_t remapValue = remap == configuration::uart::remap::None ? 0 : 0x311;
 
@@ -127,17 +133,20 @@ protected:
   @tparam <comm> communication type - via DMA or ISR. Default TX and RX via DMA
   @tparam <mode> default mode is none parity, 8 data-bits, 1 stop-bit
   @tparam <remap> remap pins of UART
+  @tparam <pinDE> driver enable pin of RS-485 transceiver: high while transmitting. void - no pin
+  @tparam <guardDE> time in bits between end of transmission and release of DE. Rounded up to whole idle frames
 */ 
 template<size_t txBufferSize, size_t rxBufferSize, 
          configuration::uart::communication comm = configuration::uart::communication::txDMA_rxDMA,
          configuration::uart::mode mode = configuration::uart::mode::N_8_1, 
-         configuration::uart::remap remap = configuration::uart::remap::None>
-class UART3 : public helper::uart::Helper<UART3<txBufferSize, rxBufferSize, comm, mode, remap>, 
-                          3, txBufferSize, rxBufferSize, comm, mode, remap>{
+         configuration::uart::remap remap = configuration::uart::remap::None,
+         typename pinDE = void, uint8_t guardDE = 0>
+class UART3 : public helper::uart::Helper<UART3<txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>, 
+                          3, txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>{
 protected:
 
-  using base = helper::uart::Helper<UART3<txBufferSize, rxBufferSize, comm, mode, remap>,
-                    3, txBufferSize, rxBufferSize, comm, mode, remap>;
+  using base = helper::uart::Helper<UART3<txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>,
+                    3, txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>;
 
   static constexpr uint32_t remapValue = remap == configuration::uart::remap::None ? 0 :
                                          remap == configuration::uart::remap::Partial  ? 0x411 : 0x412;
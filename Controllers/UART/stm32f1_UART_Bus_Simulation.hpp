@@ -0,0 +1,198 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Simulated multi-drop bus of UARTs. STM32F1-series. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _STM32F1_UART_BUS_SIMULATION_HPP
+#define _STM32F1_UART_BUS_SIMULATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "../Common/Core/Registers_Simulation.hpp"
+
+#ifndef UART_BUS_SIMULATION_NODES
+  #define UART_BUS_SIMULATION_NODES 8
+#endif
+
+/*!
+  @brief Simulation of controller's hardware on host
+*/
+namespace controller::hardware::simulation{
+
+/*!
+  @brief Multi-drop bus(e.g.: RS-485) of simulated UARTs. Element written to DR of one node
+    is received by all other nodes at once. Receiver models mute mode with wakeup by address mark:
+    element with address mark and other address mutes receiver, muted receiver ignores elements.
+    Used with REGISTERS_SIMULATION
+*/
+class UARTBus{
+
+public:
+
+  UARTBus() = delete;
+
+  /*!
+    @brief Statistics of node
+  */
+  struct Node{
+    /*! @brief Base address of UART*/
+    uint32_t base;
+    /*! @brief Called on RXNE with RXNEIE enabled, e.g.: ISR of UART*/
+    void (*ISR)();
+    /*! @brief Number of received elements*/
+    size_t received;
+    /*! @brief Number of elements ignored in mute mode*/
+    size_t muted;
+    /*! @brief Number of calls of ISR*/
+    size_t interrupts;
+    /*! @brief Number of elements lost because of not read DR*/
+    size_t overruns;
+  };
+
+  /*!
+    @brief Connect UART to bus. Registers of UART are set to reset values
+    @param [in] base address of UART
+    @param [in] isr called on received element, if RXNEIE is enabled
+    @return false, if bus is full
+  */
+  static bool Attach(uint32_t base, void (*isr)() = nullptr){
+    if (count == UART_BUS_SIMULATION_NODES) return false;
+    nodes[count++] = Node{base, isr, 0, 0, 0, 0};
+    Memory::Configure(base + offsetSR, maskSR::TXE | maskSR::TC, 0, maskSR::TC | maskSR::RXNE, 0,
+                      maskSR::TXE | maskSR::IDLE | maskSR::ORE | maskSR::NE | maskSR::FE | maskSR::PE, 0xFFFFFC00);
+    auto& dr = Memory::Configure(base + offsetDR, 0, 0, 0, 0, 0, 0xFFFFFE00);
+    dr.CallbackRead = _ReadDR;
+    dr.CallbackWrite = _WriteDR;
+    Memory::Configure(base + offsetBRR, 0, 0, 0, 0, 0, 0xFFFF0000);
+    Memory::Configure(base + offsetCR1, 0, 0, 0, 0, 0, 0xFFFFC000);
+    Memory::Configure(base + offsetCR2, 0, 0, 0, 0, 0, 0xFFFF8090);
+    Memory::Configure(base + offsetCR3, 0, 0, 0, 0, 0, 0xFFFFF800);
+    return true;
+  }
+
+  /*!
+    @brief Disconnect all nodes
+  */
+  static void Detach(){ count = 0; }
+
+  /*!
+    @brief Send element from external master of bus, that is not simulated UART
+    @param [in] element to send. Address mark is MSB of data
+  */
+  static void Transmit(uint32_t element){ _Broadcast(nullptr, element); }
+
+  /*!
+    @brief Get statistics of node
+    @param [in] base address of UART
+    @return nullptr, if node is not attached
+  */
+  static const Node* GetNode(uint32_t base){ return _Find(base); }
+
+private:
+
+  static constexpr uint32_t offsetSR = 0;
+  static constexpr uint32_t offsetDR = 4;
+  static constexpr uint32_t offsetBRR = 8;
+  static constexpr uint32_t offsetCR1 = 12;
+  static constexpr uint32_t offsetCR2 = 16;
+  static constexpr uint32_t offsetCR3 = 20;
+
+  struct maskSR{
+    static constexpr uint32_t
+      TXE = 1 << 7,
+      TC = 1 << 6,
+      RXNE = 1 << 5,
+      IDLE = 1 << 4,
+      ORE = 1 << 3,
+      NE = 1 << 2,
+      FE = 1 << 1,
+      PE = 1 << 0;
+  };
+
+  struct maskCR1{
+    static constexpr uint32_t
+      UE = 1 << 13,
+      M = 1 << 12,
+      WAKE = 1 << 11,
+      PCE = 1 << 10,
+      RXNEIE = 1 << 5,
+      TE = 1 << 3,
+      RE = 1 << 2,
+      RWU = 1 << 1;
+  };
+
+  static constexpr uint32_t maskADD = 0xF;
+
+  static inline Node nodes[UART_BUS_SIMULATION_NODES];
+  static inline size_t count = 0;
+
+  static Node* _Find(uint32_t base){
+    for (size_t i = 0; i < count; ++i)
+      if (nodes[i].base == base) return &nodes[i];
+    return nullptr;
+  }
+
+    // Write to DR: element is sent at once
+  static void _WriteDR(uint32_t address, uint32_t value){
+    Node* sender = _Find(address - offsetDR);
+    if (!sender) return;
+    uint32_t cr1 = Memory::Get(sender->base + offsetCR1);
+    if (!(cr1 & maskCR1::UE) || !(cr1 & maskCR1::TE)) return;
+    _Broadcast(sender, value & _GetMaskData(cr1));
+  }
+
+    // Read of DR clears RXNE and error flags
+  static void _ReadDR(uint32_t address, uint32_t){
+    uint32_t addressSR = address - offsetDR + offsetSR;
+    Memory::Set(addressSR, Memory::Get(addressSR) & ~(maskSR::RXNE | maskSR::ORE));
+  }
+
+  static void _Broadcast(const Node* sender, uint32_t element){
+    for (size_t i = 0; i < count; ++i)
+      if (&nodes[i] != sender) _Receive(nodes[i], element);
+  }
+
+  static void _Receive(Node& node, uint32_t element){
+    uint32_t cr1 = Memory::Get(node.base + offsetCR1);
+    if (!(cr1 & maskCR1::UE) || !(cr1 & maskCR1::RE)) return;
+    element &= _GetMaskData(cr1);
+    if ((cr1 & maskCR1::WAKE) && (element & _GetMarkAddress(cr1))){
+      uint32_t address = Memory::Get(node.base + offsetCR2) & maskADD;
+      cr1 = (element & maskADD) == address ? cr1 & ~maskCR1::RWU : cr1 | maskCR1::RWU;
+      Memory::Set(node.base + offsetCR1, cr1);
+    }
+    if (cr1 & maskCR1::RWU){
+      node.muted++;
+      return;
+    }
+    uint32_t sr = Memory::Get(node.base + offsetSR);
+    if (sr & maskSR::RXNE){
+      node.overruns++;
+      Memory::Set(node.base + offsetSR, sr | maskSR::ORE);
+      return;
+    }
+    node.received++;
+    Memory::Set(node.base + offsetDR, element);
+    Memory::Set(node.base + offsetSR, sr | maskSR::RXNE);
+    if ((cr1 & maskCR1::RXNEIE) && node.ISR){
+      node.interrupts++;
+      node.ISR();
+    }
+  }
+
+    // Word length: 9 bits, if M is set. Parity bit is not part of data
+  static uint32_t _GetMaskData(uint32_t cr1){ return (_GetMarkAddress(cr1) << 1) - 1; }
+
+  static uint32_t _GetMarkAddress(uint32_t cr1){
+    uint32_t countBits = (cr1 & maskCR1::M ? 9 : 8) - (cr1 & maskCR1::PCE ? 1 : 0);
+    return 1U << (countBits - 1);
+  }
+
+};
+
+} // !namespace controller::hardware::simulation
+
+#endif // !_STM32F1_UART_BUS_SIMULATION_HPP
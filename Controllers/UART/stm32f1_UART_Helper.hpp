@@ -11,12 +11,22 @@
 
 #include "../Common/Compiler/Compiler.h"
 #include "../Common/Core/Interrupt.hpp"
+#include "../Common/Core/DWT.hpp"
 #include "../Interfaces/IPower.hpp"
 #include "../Interfaces/IConnection.hpp"
 #include "../Clock/stm32f1_Clock.hpp"
 #include "../Pinlist/stm32f1_Pinlist.hpp"
 #include "../DMA/stm32f1_DMA.hpp"
 
+#ifndef UART_TX_QUEUE_SIZE
+  #define UART_TX_QUEUE_SIZE 8
+#endif
+
+  // Max error of baud rate in 0.01%
+#ifndef UART_BAUD_TOLERANCE
+  #define UART_BAUD_TOLERANCE 200
+#endif
+
 /*!
   @brief Configuration for UART
 */ 
@@ -112,6 +122,34 @@ using namespace controller::interfaces;
 using namespace controller::hardware;
 using namespace controller::configuration::dma;
 
+/*!
+  @brief Number of data bits in mode: word length without parity bit
+*/
+template<mode mode>
+constexpr uint32_t countDataBits = ((uint32_t)mode & 0x1000 ? 9 : 8) - ((uint32_t)mode & 0x400 ? 1 : 0);
+
+/*!
+  @brief Type of buffers elements: uint16_t for 9 data bits, otherwise uint8_t
+*/
+template<mode mode>
+using element_t = std::conditional_t<countDataBits<mode> == 9, uint16_t, uint8_t>;
+
+/*!
+  @brief Driver enable pin of RS-485 transceiver
+  @tparam <pin> pin of DE. void - no pin
+*/
+template<typename pin>
+struct driverEnable{
+  using type = typename pin::mode::template set<controller::configuration::pin::Output_Low_50MHz>;
+  using pins = trait::Typelist<type>;
+};
+
+template<>
+struct driverEnable<void>{
+  using type = void;
+  using pins = trait::Typelist<>;
+};
+
 /*!
   @brief UART-Helper for STM32F1 series. Don't use it Directly
   @tparam <adapter> specific UART device
@@ -121,15 +159,17 @@ using namespace controller::configuration::dma;
   @tparam <comm> communication type: via DMA or ISR
   @tparam <mode> parity, size of data, number of stop bits
   @tparam <remap> remap pins of UART
+  @tparam <pinDE> driver enable pin of RS-485 transceiver. void - no pin
+  @tparam <guardDE> time in bits between end of transmission and release of DE. Rounded up to whole idle frames
 */  
 template<typename adapter, uint32_t uartID, size_t txBufferSize, size_t rxBufferSize, 
-         communication comm, mode mode, remap remap>
-class Helper: public IConnection<uint8_t, txBufferSize, rxBufferSize, controller::interface::UART,
-                                 Helper<adapter, uartID, txBufferSize, rxBufferSize, comm, mode, remap>>, 
-              private controller::Clock{
+         communication comm, mode mode, remap remap, typename pinDE, uint8_t guardDE>
+class Helper: public IConnection<element_t<mode>, txBufferSize, rxBufferSize, controller::interface::UART,
+                                 Helper<adapter, uartID, txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>>, 
+              private controller::hardware::Registers{
 
-  using connection = IConnection<uint8_t, txBufferSize, rxBufferSize, controller::interface::UART,
-                                Helper<adapter, uartID, txBufferSize, rxBufferSize, comm, mode, remap>>;
+  using connection = IConnection<element_t<mode>, txBufferSize, rxBufferSize, controller::interface::UART,
+                                Helper<adapter, uartID, txBufferSize, rxBufferSize, comm, mode, remap, pinDE, guardDE>>;
 
 
   struct dma{
@@ -171,7 +211,13 @@ class Helper: public IConnection<uint8_t, txBufferSize, rxBufferSize, controller
         RXNEIE = 1 << 5, // RXNE interrupt enable
         IDLEIE = 1 << 4, // IDLE interrupt enable
         TE = 1 << 3, // Transmitter enable
-        RE = 1 << 2; // Receiver enable
+        RE = 1 << 2, // Receiver enable
+        WAKE = 1 << 11, // Wakeup by address mark
+        RWU = 1 << 1; // Receiver in mute mode
+    };
+    struct CR2{
+      static constexpr uint32_t 
+        ADD = 0xF; // Address of node
     };
     struct CR3{
       static constexpr uint32_t 
@@ -181,43 +227,72 @@ class Helper: public IConnection<uint8_t, txBufferSize, rxBufferSize, controller
 
 public:
 
+  using type = typename connection::type;
+
   /*!
-    @brief Initialization of UART
+    @brief Initialization of UART. Value of BRR is computed at compile time
     @tparam <baud> desired baud-rate for uart
+    @tparam <clock> clock tree. Should be the same as in Clock::Set
   */  
-  template<uint32_t baud>
+  template<uint32_t baud, typename clock = controller::Clock::Tree<>>
   static void Init(){
     Registers::_Write<address::CR1, valueCR1>();
 
     if constexpr (valueCR2)
       Registers::_Write<address::CR2, valueCR2>();
     Registers::_Write<address::CR3, valueCR3>();
-    Registers::_Write<address::BRR>(_CalculateBRR<baud>());
+    Registers::_Write<address::BRR, _CalculateBRR<baud, clock>()>();
+    if constexpr (connection::isRxTimestamps)
+      controller::DWT::Enable();
 
     if constexpr (isRXDMA || isTXDMA){
       if constexpr(isRXDMA){
-        auto memoryAddress = reinterpret_cast<uint32_t>(connection::rxBuffer.GetHeadAddress());
         dma::rx::template SetPeripheral<address::DR>();
-        dma::rx::template SetMemory(memoryAddress);
+        dma::rx::SetMemory(connection::rxBuffer.GetHeadAddress());
         dma::rx::template SetCount<rxBufferSize>();
         dma::rx::template Init<true, minc::MINC_Enabled, pinc::PINC_Disabled,
-                               dir::DIR_ToMemory, circ::CIRC_Enabled, isr::ISR_None>();
+                               dir::DIR_ToMemory, circ::CIRC_Enabled, isr::ISR_TC_HT,
+                               valueDataSize, valueDataSize, priority::High>();
       }
       if constexpr(isTXDMA){
         dma::tx::template SetPeripheral<address::DR>();
         dma::tx::template Init<false, minc::MINC_Enabled, pinc::PINC_Disabled,
-                               dir::DIR_ToPeripheral, circ::CIRC_Disabled, isr::ISR_TC>();
+                               dir::DIR_ToPeripheral, circ::CIRC_Disabled, isr::ISR_TC,
+                               valueDataSize, valueDataSize, priority::Medium>();
       }
     }
   }
 
   /*!
-    @brief Set baud rate
+    @brief Set baud rate. Value of BRR is computed at compile time
     @tparam <baud> desired baud-rate for uart
+    @tparam <clock> clock tree. Should be the same as in Clock::Set
   */ 
-  template<uint32_t baud>
+  template<uint32_t baud, typename clock = controller::Clock::Tree<>>
   __FORCE_INLINE static void SetBaud(){
-    Registers::_Write<address::BRR>(_CalculateBRR<baud>());
+    Registers::_Write<address::BRR, _CalculateBRR<baud, clock>()>();
+  }
+
+  /*!
+    @brief Get actual baud rate for desired one
+    @tparam <baud> desired baud-rate for uart
+    @tparam <clock> clock tree
+  */
+  template<uint32_t baud, typename clock = controller::Clock::Tree<>>
+  static constexpr uint32_t GetBaud(){
+    return (valueClock<clock> + (valueBRR<baud, clock> >> 1)) / valueBRR<baud, clock>;
+  }
+
+  /*!
+    @brief Get error of actual baud rate in 0.01%
+    @tparam <baud> desired baud-rate for uart
+    @tparam <clock> clock tree
+  */
+  template<uint32_t baud, typename clock = controller::Clock::Tree<>>
+  static constexpr uint32_t GetBaudError(){
+    uint64_t actual = uint64_t(valueBRR<baud, clock>) * baud;
+    uint64_t difference = actual > valueClock<clock> ? actual - valueClock<clock> : valueClock<clock> - actual;
+    return static_cast<uint32_t>((difference * 10000 + (actual >> 1)) / actual);
   }
 
   /*!
@@ -226,10 +301,67 @@ public:
   __FORCE_INLINE static void ISR_DMA_TX(){
     dma::tx::ClearFlags();
     dma::tx::Disable();
+    txInterrupts++;
+    _CompleteTxDMA();
+    if (!_EnableTxDMA()){
+      if constexpr (isDE) 
+        if (isPendingDE) _ReleaseDE(false);
+      connection::_NotifyIdleTx(); 
+    }
+  }
+
+  /*!
+    @brief Enqueue caller-owned data to send via DMA without copying to tx buffer.
+      Data is sent after data written before, descriptors are chained in DMA TX Handler.
+      Data should stay valid till transmission is complete
+    @param [in] data pointer to data
+    @param [in] size of data
+    @param [in] completion called from DMA TX Handler after data is sent
+    @return false, if queue of descriptors or tx buffer is full
+  */
+  static bool Enqueue(const type* data, size_t size, void (*completion)() = nullptr){
+    static_assert(isTXDMA, "Enqueue requires TX via DMA");
+    if (!size) return true;
+    if (txQueue.GetCountToOverflow() < 2 || !connection::txBuffer.GetCountToOverflow())
+      return false;
     if (!connection::txBuffer.IsEmpty())
-      _EnableTxDMA();
-    else if (connection::CallbackIdleTX)
-      connection::CallbackIdleTX(); 
+      txQueue.Push(descriptor{_GetTxTailAddress(), 0, nullptr});
+    txQueue.Push(descriptor{data, size, completion});
+    _Send();
+    return true;
+  }
+
+  /*!
+    @brief Get number of DMA TX interrupts since ResetTxCounters
+  */
+  __FORCE_INLINE static uint32_t GetTxInterrupts(){ return txInterrupts; }
+
+  /*!
+    @brief Get number of bytes sent via DMA since ResetTxCounters
+  */
+  __FORCE_INLINE static uint32_t GetTxSent(){ return txSent; }
+
+  /*!
+    @brief Get number of DMA TX interrupts per 1024 sent bytes
+  */
+  static uint32_t GetTxInterruptsPerKB(){
+    return txSent ? static_cast<uint32_t>((uint64_t(txInterrupts) << 10) / txSent) : 0;
+  }
+
+  /*!
+    @brief Reset counters of DMA TX interrupts and sent bytes
+  */
+  __FORCE_INLINE static void ResetTxCounters(){ txInterrupts = txSent = 0; }
+
+  /*!
+    @brief DMA RX Handler. Half transfer and transfer complete events move rx buffer's tail,
+      so long stream is available before IDLE
+  */ 
+  __FORCE_INLINE static void ISR_DMA_RX(){
+    _CheckRxDMA();
+    _StampRx();
+    if (!connection::rxBuffer.IsEmpty())
+      connection::_NotifyRx();
   }
 
   /*!
@@ -237,31 +369,45 @@ public:
   */ 
   __FORCE_INLINE static void ISR(){
     valueSR = Registers::_Read<address::SR>();
-    uint8_t drValue = Registers::_Read<address::DR>();
+    type drValue = Registers::_Read<address::DR>();
 
+    [[maybe_unused]] bool isWritten = false;
     if constexpr (!isTXDMA){
       if (valueSR & mask::SR::TXE){
-        if (!connection::txBuffer.IsEmpty())
+        if (!connection::txBuffer.IsEmpty()){
           Registers::_Write<address::DR>(connection::txBuffer.Pop());
+          isWritten = true;
+        }
+        else if constexpr (isDE) Registers::_Clear<address::CR1, mask::CR1::TXEIE>();
         else Registers::_Clear<address::CR1, mask::CR1::TXEIE | mask::CR1::TCIE>();
       }
     }
 
     if constexpr (!isRXDMA){
-      if (valueSR & mask::SR::RXNE)
+      if (valueSR & mask::SR::RXNE){
         connection::rxBuffer.Push(drValue);
+        connection::_CountRx(1);
+          // First element after IDLE line is start of message
+        if (isRxIdle){
+          isRxIdle = false;
+          _StampRx();
+        }
+      }
     }
 
     if (valueSR & mask::SR::TC){
       Registers::_Set<address::SR, 0U, mask::SR::TC>();
-      if (connection::CallbackIdleTX)
-        connection::CallbackIdleTX();
+      if constexpr (isDE) 
+        _ReleaseDE(isWritten);
+      connection::_NotifyIdleTx();
     }
 
-    if (valueSR & mask::SR::IDLE && connection::CallbackRxNotEmpty){
+    if (valueSR & mask::SR::IDLE){
       if constexpr(isRXDMA) 
         _CheckRxDMA();
-      connection::CallbackRxNotEmpty();
+      _StampRx();
+      isRxIdle = true;
+      connection::_NotifyRx();
     }
 
     if((valueSR & (mask::SR::ORE | mask::SR::PE | mask::SR::NE | mask::SR::FE)) && connection::CallbackError){
@@ -276,6 +422,7 @@ public:
     (void) Registers::_Read<address::SR>();
     (void) Registers::_Read<address::DR>();
     valueSR = 0;
+    error.overflow = false;
   }
 
   /*!
@@ -289,6 +436,51 @@ public:
     return error;
   }
 
+  /*!
+    @brief Address mark: MSB of data. Element with address mark holds address of node in 4 low bits
+  */
+  static constexpr type markAddress = type(1U << (countDataBits<mode> - 1));
+
+  /*!
+    @brief Enable multi-drop receive with wakeup by address mark. Receiver is muted till element 
+      with address mark and address of node. Element with other address mutes receiver by hardware, 
+      so frames of other nodes don't generate interrupts and DMA requests. 
+      Element with address of node is received as the first element of frame
+    @tparam <nodeAddress> address of node in range [0, 15]
+  */
+  template<uint8_t nodeAddress>
+  static void EnableAddressMark(){
+    static_assert(nodeAddress <= mask::CR2::ADD, "Address of node should be in range [0, 15]");
+    Registers::_Set<address::CR2, uint32_t(nodeAddress), mask::CR2::ADD>();
+    Registers::_Set<address::CR1, mask::CR1::WAKE | mask::CR1::RWU>();
+  }
+
+  /*!
+    @brief Disable multi-drop receive: all elements are received
+  */
+  __FORCE_INLINE static void DisableAddressMark(){
+    Registers::_Clear<address::CR1, mask::CR1::WAKE | mask::CR1::RWU>();
+  }
+
+  /*!
+    @brief Mute receiver till next element with address of node, e.g.: at the end of frame
+  */
+  __FORCE_INLINE static void Mute(){ Registers::_Set<address::CR1, mask::CR1::RWU>(); }
+
+  /*!
+    @brief Check mute mode of receiver
+  */
+  __FORCE_INLINE static bool IsMuted(){ return Registers::_Read<address::CR1, mask::CR1::RWU>(); }
+
+  /*!
+    @brief Write element with address mark, that wakes up receiver of node
+    @param [in] nodeAddress address of node in range [0, 15]
+    @return true, if tx buffer not overflowed
+  */
+  __FORCE_INLINE static bool WriteAddress(uint8_t nodeAddress){
+    return connection::Write(type(markAddress | (nodeAddress & mask::CR2::ADD)));
+  }
+
 protected:
 
   struct error{
@@ -296,15 +488,34 @@ protected:
     bool overrun;
     bool noise;
     bool frame;
+    bool overflow; // RX DMA overwrote unread data of rx buffer
   };
   
+    // Transfer of caller-owned data. Size 0 - end of tx buffer's segment, written before next descriptor
+  struct descriptor{
+    const type* data;
+    size_t size;
+    void (*completion)();
+  };
+
   static inline error error;
   static inline size_t countPrevRxBuffer = rxBufferSize;
   static inline uint32_t valueSR = 0;
+  static inline container::CircularBuffer<descriptor, UART_TX_QUEUE_SIZE, 
+                                          container::overflow::Drop, container::storage::Atomic> txQueue;
+  static inline size_t countTxDMA = 0;
+  static inline bool isTxDMAQueue = false;
+  static inline uint32_t txInterrupts = 0;
+  static inline uint32_t txSent = 0;
+  static inline uint32_t countGuardDE = 0;
+  static inline bool isPendingDE = false;
+  static inline bool isRxIdle = true;
 
   __FORCE_INLINE static void _Send(){
-    if constexpr(!isTXDMA) 
+    if constexpr(!isTXDMA){
+      _AssertDE();
       Registers::_Set<address::CR1, mask::CR1::TXEIE | mask::CR1::TCIE>();
+    }
     else if (!dma::tx::IsEnabled()) 
       _EnableTxDMA();
   }
@@ -313,25 +524,125 @@ protected:
 
   __FORCE_INLINE static void _CheckRxBuffer(){ }
 
-  static void _EnableTxDMA(){
-    auto memoryAddress = reinterpret_cast<uint32_t>(connection::txBuffer.GetHeadAddress());
-    dma::tx::SetCount(connection::txBuffer.GetCountToBufferLastIndex());
-    dma::tx::SetMemory(memoryAddress);
-    connection::txBuffer.SetHeadToLastIndex();
+    // Start DMA with front descriptor or tx buffer. 
+    // Head of tx buffer is moved after transfer, so data being sent is not overwritten
+  static bool _EnableTxDMA(){
+    while (!txQueue.IsEmpty()){
+      auto& front = txQueue.Front();
+      if (front.size){
+        _StartTxDMA(front.data, front.size, true);
+        return true;
+      }
+      auto head = _GetTxHeadAddress();
+      if (head != front.data){
+        size_t count = connection::txBuffer.GetCountToBufferLastIndex();
+        if (front.data > head && size_t(front.data - head) < count) count = front.data - head;
+        _StartTxDMA(head, count, false);
+        return true;
+      }
+      txQueue.Pop();
+    }
+    if (connection::txBuffer.IsEmpty())
+      return false;
+    _StartTxDMA(_GetTxHeadAddress(), connection::txBuffer.GetCountToBufferLastIndex(), false);
+    return true;
+  }
+
+  __FORCE_INLINE static void _StartTxDMA(const type* data, size_t count, bool isQueue){
+    countTxDMA = count;
+    isTxDMAQueue = isQueue;
+    dma::tx::SetCount(count);
+    dma::tx::SetMemory(data);
+    if constexpr (isDE){
+      _AssertDE();
+      Registers::_Set<address::SR, 0U, mask::SR::TC>(); // TC of previous transfer doesn't release DE
+    }
     dma::tx::Enable();
   }
 
+    // Release data of finished transfer
+  __FORCE_INLINE static void _CompleteTxDMA(){
+    size_t count = countTxDMA;
+    countTxDMA = 0;
+    txSent += count;
+    if (isTxDMAQueue){
+      isTxDMAQueue = false;
+      auto sent = txQueue.Pop();
+      if (sent.completion) sent.completion();
+    } else connection::txBuffer.AddToHead(count);
+  }
+
+  __FORCE_INLINE static const type* _GetTxHeadAddress(){
+    return const_cast<const type*>(connection::txBuffer.GetHeadAddress());
+  }
+
+  __FORCE_INLINE static const type* _GetTxTailAddress(){
+    return const_cast<const type*>(connection::txBuffer.GetTailAddress());
+  }
+
+  __FORCE_INLINE static void _AssertDE(){
+    if constexpr (isDE){
+      isPendingDE = false;
+      countGuardDE = 0;
+      pinDE::High();
+    }
+  }
+
+    // TC is set, when shift register is empty. DE is released, if nothing is left to send:
+    // DMA is not restarted or no element is written to DR in this ISR.
+    // TC before DMA TX Handler is pending till the handler finds nothing to send.
+    // Guard time is measured by idle frames: each of them ends with TC, so ISR isn't blocked
+  static void _ReleaseDE(bool isWritten){
+    if constexpr (isTXDMA){
+      isPendingDE = dma::tx::IsEnabled();
+      if (isPendingDE) return;
+    } else {
+      if (isWritten || !connection::txBuffer.IsEmpty()) return;
+    }
+    if (countGuardDE < countGuardFrames){
+      countGuardDE++;
+      _SendIdle();
+      return;
+    }
+    if constexpr (!isTXDMA)
+      Registers::_Clear<address::CR1, mask::CR1::TCIE>();
+    pinDE::Low();
+  }
+
+    // TE from 0 to 1 sends idle frame: line is high for one frame, then TC is set
+  __FORCE_INLINE static void _SendIdle(){
+    Registers::_Clear<address::CR1, mask::CR1::TE>();
+    Registers::_Set<address::CR1, mask::CR1::TE>();
+  }
+
+    // Time of rx event in core cycles
+  __FORCE_INLINE static void _StampRx(){
+    if constexpr (connection::isRxTimestamps)
+      connection::_StampRx(controller::DWT::GetCycles());
+  }
+
+    // Counter and flag are one snapshot: flag is read again after counter, so wrap between reads is seen with new counter.
+    // Transfer complete flag is cleared only, if wrap is counted, otherwise wrap after the snapshot is seen by the next check.
+    // Received count is more than size of buffer, if DMA lapped unread data
   static void _CheckRxDMA(){
-    size_t count = dma::rx::GetCount();
     bool isTransferComplete = dma::rx::IsTransferComplete();
+    size_t count = dma::rx::GetCount();
+    if (!isTransferComplete && dma::rx::IsTransferComplete()){
+      isTransferComplete = true;
+      count = dma::rx::GetCount();
+    }
+    if (isTransferComplete) dma::rx::ClearFlags();
+    else dma::rx::ClearHalfTransfer();
     if(countPrevRxBuffer != count || isTransferComplete){
-      size_t diff = countPrevRxBuffer > count ? 
-                    countPrevRxBuffer - count  + (isTransferComplete ? rxBufferSize : 0) : 
-                    rxBufferSize - count + countPrevRxBuffer;
+      size_t diff = countPrevRxBuffer + (isTransferComplete ? rxBufferSize : 0) - count;
+      if (diff > connection::rxBuffer.GetCountToOverflow()){
+        error.overflow = true;
+        if (connection::CallbackError) connection::CallbackError();
+      }
       connection::rxBuffer.AddToTail(diff);
+      connection::_CountRx(diff);
       countPrevRxBuffer = count;
     }
-    dma::rx::ClearFlags();
   }
 
   static constexpr bool isTXDMA = comm == communication::txDMA_rxDMA ||
@@ -356,11 +667,31 @@ protected:
   static constexpr uint32_t valueCR3 = mask::CR3::EIE | // Enable error ISR 
                                       (((uint32_t)comm >> 8) & 0xC0); // Enable DMAT and DMAR
 
-  template<uint32_t baud>
-  __FORCE_INLINE static uint32_t _CalculateBRR(){ 
-    return ((baud>>1) + (uartID == 1 ? 
-    Clock::APB2() : 
-    Clock::APB1()))/baud;
+  static constexpr bool isDE = !std::is_void_v<pinDE>;
+
+    // Start bit, data bits with parity and stop bits. Stop bits 0.5 and 1.5 are rounded down
+  static constexpr uint32_t countFrameBits = 1 + ((uint32_t)mode & 0x1000 ? 9 : 8) + 
+                                             (((uint32_t)mode & 0xC000) == 0x4000 ? 0 :
+                                              ((uint32_t)mode & 0xC000) == 0x8000 ? 2 : 1);
+
+    // Idle frames sent before release of DE
+  static constexpr uint32_t countGuardFrames = (guardDE + countFrameBits - 1) / countFrameBits;
+
+  static constexpr data_size valueDataSize = sizeof(type) == 2 ? data_size::Size_16 : data_size::Size_8;
+
+  template<typename clock>
+  static constexpr uint32_t valueClock = uartID == 1 ? clock::valueAPB2 : clock::valueAPB1;
+
+  template<uint32_t baud, typename clock>
+  static constexpr uint32_t valueBRR = (valueClock<clock> + (baud >> 1)) / baud;
+
+  template<uint32_t baud, typename clock>
+  static constexpr uint32_t _CalculateBRR(){ 
+    static_assert(baud && valueBRR<baud, clock> >= 0x10 && valueBRR<baud, clock> <= 0xFFFF, 
+                  "Baud rate is out of range for clock of bus");
+    static_assert(GetBaudError<baud, clock>() <= UART_BAUD_TOLERANCE, 
+                  "Error of baud rate is out of tolerance(UART_BAUD_TOLERANCE)");
+    return valueBRR<baud, clock>;
   }
 
   template<typename>
@@ -368,6 +699,8 @@ protected:
 
   friend controller::Interrupt;
 
+  friend controller::DMAManager;
+
   template<typename...>
   friend class helper::pinlist::Helper;
 
@@ -380,9 +713,14 @@ protected:
           (isTXDMA || isRXDMA) ? adapter::power::DMAEN : 0, 
           adapter::power::UARTEN, 
           adapter::power::UART1EN>;
-    using power = typename controller::Power::fromPeripherals<powerUart, TX, RX>::power;
-    using pins = trait::Typelist<TX, RX>;
-    using interrupts = trait::remove_value_t<0,trait::Valuelist<adapter::irq::UART, isTXDMA ? adapter::irq::DMATX : 0>>;
+    using DE = typename driverEnable<pinDE>::type;
+    using power = typename controller::Power::fromPeripherals<powerUart, TX, RX, 
+                                                             std::conditional_t<isDE, DE, powerUart>>::power;
+    using pins = trait::push_front_t<trait::push_front_t<typename driverEnable<pinDE>::pins, RX>, TX>;
+    using interrupts = trait::remove_value_t<0,trait::Valuelist<adapter::irq::UART, 
+                                                                isTXDMA ? adapter::irq::DMATX : 0,
+                                                                isRXDMA ? adapter::irq::DMARX : 0>>;
+    using channelsDMA = trait::remove_value_t<0,trait::Valuelist<isTXDMA ? dma::tx::id : 0, isRXDMA ? dma::rx::id : 0>>;
   };
 
 };
@@ -1,15 +1,32 @@
 #ifndef _MFRC522_HPP
 #define _MFRC522_HPP
 
+#if !defined(__cpp_impl_coroutine)
+  #error "MFRC522 requires C++20 coroutines"
+#endif
+
 #include <cstdint>
 #include <array>
-#include "../Controllers/Common/Compiler/Compiler.h"
+#include <atomic>
+#include <type_traits>
+#include "../../Controllers/Common/Compiler/Compiler.h"
+#include "../../Utils/Coroutine.hpp"
 
 namespace device{
 
+/*!
+  @brief RFID reader MFRC522 via SPI. Each command is a coroutine: sequence of register exchanges
+    is resumed from ISR of interface and from IRQ pin. One command at a time.
+    Buffers of interface should hold address and FIFO: not less than 65 elements
+  @tparam <interface> connection with awaitables, e.g.: SPI1
+  @tparam <pinNSS> chip select, active low
+  @tparam <pinIRQ> interrupt pin of chip with CallbackEvent, e.g.: ExternalEvent. Required by commands with IRQ
+*/
 template<typename interface, typename pinNSS, typename pinIRQ = void>
 class MFRC522{
 
+  using Task = utils::coroutine::Task;
+
   enum registers{
     /*! @brief starts and stops command execution*/
     CommandReg = 0x02,
@@ -156,6 +173,11 @@ struct command{
 
 
   static constexpr size_t sizeFIFO = 64;
+    // The largest exchange is address of FIFO and its data. Write of it is dropped, if tx buffer is less,
+    // and ReadExactly never completes, if rx buffer is less
+  static constexpr size_t sizeExchangeMax = sizeFIFO + 1;
+  static_assert(interface::sizeTxBuffer >= sizeExchangeMax && interface::sizeRxBuffer >= sizeExchangeMax,
+                "Buffers of interface should hold address and FIFO: not less than 65 elements");
   static inline size_t sizeUsedFIFO = 0;
   // BitFramingReg: used for transmission of bit oriented frames: defines the number of bits of the last byte that will be transmitted
   static inline uint8_t TxLastBits = 0;
@@ -166,7 +188,7 @@ public:
 static inline size_t sizeToRead = 0;
   static inline std::array<uint8_t, sizeFIFO> bufferFIFO;
 
-  static void Init(){
+  static Task Init(){
     static constexpr std::array<uint8_t, 14> arrayInit { 
       registers::CommandReg, command::SoftReset,
       registers::TPrescalerReg, 0xA9, // A9 f_timer=40kHz, ie a timer period of 25us.
@@ -175,10 +197,11 @@ static inline size_t sizeToRead = 0;
       registers::TxControlReg, 0x83, // Enable the antenna driver pins TX1 and TX2
       registers::TxASKReg, 0x40, // forces a 100 % ASK modulation
       registers::ModeReg, 0x3D}; //set the preset value for the CRC coprocessor for the CalcCRC command to 0x6363
-    WriteData(arrayInit.data(), arrayInit.size(), 2);
+    for (size_t i = 0; i < arrayInit.size(); i += 2)
+      co_await _Exchange(arrayInit.data() + i, 2);
   }
 
-  static void CalculateCRC1(size_t size){
+  static Task CalculateCRC1(size_t size){
     static constexpr std::array<uint8_t, 14> arrayConfig{
       registers::CommandReg, command::chip::Idle, // Stop Command
       registers::ComIEnReg, 0x81,
@@ -188,91 +211,68 @@ static inline size_t sizeToRead = 0;
       registers::FIFOLevelReg, 0x80, // Flush fifo buffer
       registers::ControlReg, 0x40}; //the CalcCRC command is active and all data is processed
     static constexpr std::array<uint8_t, 2> arrayCommandCRC{registers::CommandReg, command::chip::CalcCRC};
-    static constexpr std::array<uint8_t, 2> arrayReadCRC{registers::CRCResultRegL | 0x80, registers::CRCResultRegH | 0x80};
-
-    static auto _size = size;
-
-    WriteData(arrayConfig.data(), arrayConfig.size() - 2, 2);
-    CallbackEndTransmission = [](){
-      interface::Push(registers::FIFODataReg);
-      WriteData(bufferFIFO.data(), _size, 0);
-      CallbackEndTransmission = [](){
-        CallbackEndTransmission = nullptr;
-        WriteData(arrayCommandCRC.data(), arrayCommandCRC.size(), 2);
-        pinIRQ::CallbackEvent = [](){
-          pinIRQ::CallbackEvent = nullptr;
-          interface::FlushRX();
-          ReadData(arrayReadCRC.data(), arrayReadCRC.size());
-          CallbackEndTransmission = [](){
-            CallbackEndTransmission = nullptr;
-            (void) interface::Read();
-            bufferFIFO[2] = interface::Read();
-            bufferFIFO[3] = interface::Read();
-            if (CallbackCommandComplete){
-              CallbackCommandComplete();
-              CallbackCommandComplete = nullptr;
-            }
-          };
-        };
-      };
-    };
-
+    static constexpr std::array<uint8_t, 3> arrayReadCRC{registers::CRCResultRegL | 0x80, registers::CRCResultRegH | 0x80, 0};
+
+    for (size_t i = 0; i < arrayConfig.size() - 2; i += 2)
+      co_await _Exchange(arrayConfig.data() + i, 2);
+    co_await _WriteFIFO(size);
+    _ArmIRQ();
+    co_await _Exchange(arrayCommandCRC.data(), arrayCommandCRC.size());
+    co_await _AwaitIRQ{};
+    co_await _Exchange(arrayReadCRC.data(), arrayReadCRC.size());
+    (void) interface::Read();
+    bufferFIFO[2] = interface::Read();
+    bufferFIFO[3] = interface::Read();
+    if (CallbackCommandComplete) CallbackCommandComplete();
   }
 
-static void Cm_PICC(){
+  // Data of FIFO is sent to PICC, answer of sizeToRead bytes is read to FIFO buffer
+static Task Cm_PICC(){
   static constexpr std::array<uint8_t, 10> config{
     registers::ComIEnReg, 0xA0, // Enable RxIEn
     registers::DivIEnReg, 0x80, // Enable CRC Interrupt
     registers::ComIrqReg, 0x7F, // Clear interrupts
     registers::DivIrqReg, 0x7F, // Clear Interrupts
     registers::FIFOLevelReg, 0x80}; // Flush fifo buffer
-  static std::array<uint8_t, 4> commandSend{
-    registers::CommandReg, command::chip::Transeive,
-    registers::BitFramingReg, 0x80};
-  commandSend[1] = command;
-  commandSend[3] = uint8_t(0x80 | TxLastBits);
-
-  static size_t commandSendSize = 0;
-  commandSendSize = commandSend.size() - (command == command::chip::Transeive ? 0 : 2);
-
-  WriteData(config.data(), config.size(), 2);
-  CallbackEndTransmission = [](){
-    interface::Push(registers::FIFODataReg);
-    WriteData(bufferFIFO.data(), sizeUsedFIFO, 0);
-    CallbackEndTransmission = [](){
-      CallbackEndTransmission = nullptr;
-      WriteData(commandSend.data(), commandSendSize, 2);
-      pinIRQ::CallbackEvent = [](){
-        pinIRQ::CallbackEvent = nullptr;
-        if (CallbackInternalComplete) CallbackInternalComplete();
-      };
-    };
-  };
-
+  const std::array<uint8_t, 4> commandSend{
+    registers::CommandReg, uint8_t(command),
+    registers::BitFramingReg, uint8_t(0x80 | TxLastBits)};
+  const size_t commandSendSize = commandSend.size() - (command == command::chip::Transeive ? 0 : 2);
+
+  for (size_t i = 0; i < config.size(); i += 2)
+    co_await _Exchange(config.data() + i, 2);
+  co_await _WriteFIFO(sizeUsedFIFO);
+  _ArmIRQ();
+  for (size_t i = 0; i < commandSendSize; i += 2)
+    co_await _Exchange(commandSend.data() + i, 2);
+  co_await _AwaitIRQ{};
+  if (sizeToRead){
+    co_await _ReadFIFO();
+    _StoreFIFO();
+  }
+  if (CallbackCommandComplete) CallbackCommandComplete();
 }
 
-static void SetPICCtoReady(){
+static Task SetPICCtoReady(){
   bufferFIFO[0] = command::picc::WUPA;
   sizeUsedFIFO = 1;
   TxLastBits = 7;
   sizeToRead = 2;
   command = command::chip::Transeive;
-  CallbackInternalComplete = ReadFIFO;
-  Cm_PICC();
+  return Cm_PICC();
 }
 
-static void GetUID(){
+static Task GetUID(){
   bufferFIFO[0] = command::picc::SEL_CL1;
   bufferFIFO[1] = 0x20;
   sizeUsedFIFO = 2;
   TxLastBits = 0;
   sizeToRead = 5;
   command = command::chip::Transeive;
-  CallbackInternalComplete = ReadFIFO;
-  Cm_PICC();
+  return Cm_PICC();
 }
 
-static void Select(){
+static Task Select(){
   bufferFIFO[0] = command::picc::SEL_CL1;
   bufferFIFO[1] = 0x70;
   // UID
@@ -287,12 +287,11 @@ static void Select(){
   TxLastBits = 0;
   sizeToRead = 3;
   command = command::chip::Transeive;
-  CallbackInternalComplete = ReadFIFO;
   CalculateCRC();
-  Cm_PICC();
+  return Cm_PICC();
 }
 
-static void Authentication(uint8_t numberBlock){
+static Task Authentication(uint8_t numberBlock){
   bufferFIFO[0] = command::picc::MF_AUTH_KEY_A;
   bufferFIFO[1] = numberBlock;
   for(size_t i = 0; i < 6; ++i)
@@ -302,11 +301,12 @@ static void Authentication(uint8_t numberBlock){
   bufferFIFO[10] = 0xdb;
   bufferFIFO[11] = 0x48;
   sizeUsedFIFO = 12;
+  sizeToRead = 0;
   command = command::chip::MFAuthent;
-  Cm_PICC();
+  return Cm_PICC();
 }
 
-static void AuthenticationHack(uint8_t number){
+static Task AuthenticationHack(uint8_t number){
   bufferFIFO[0] = command::picc::MF_AUTH_KEY_A;
   bufferFIFO[1] = 0;
   
@@ -322,64 +322,26 @@ static void AuthenticationHack(uint8_t number){
   bufferFIFO[10] = 0xdb;
   bufferFIFO[11] = 0x48;
   sizeUsedFIFO = 12;
+  sizeToRead = 0;
   command = command::chip::MFAuthent;
-  Cm_PICC();
+  return Cm_PICC();
 }
 
-static void Read(uint8_t numberBlock){
+static Task Read(uint8_t numberBlock){
   bufferFIFO[0] = command::picc::MF_READ;
   bufferFIFO[1] = numberBlock;
   sizeUsedFIFO = 2;
   sizeToRead = 16;
   TxLastBits = 0;
   command = command::chip::Transeive;
-  CallbackInternalComplete = ReadFIFO;
   CalculateCRC();
-  Cm_PICC();
-}
-
-static void ReadFIFO(){
-  CallbackInternalComplete = nullptr;
-  interface::FlushRX();
-  interface::Push(registers::FIFODataReg | 0x80, sizeToRead);
-  ReadData();
-  CallbackEndTransmission = [](){
-    CallbackEndTransmission = nullptr;
-    (uint8_t)interface::Read();
-    for(size_t i = 0; i < sizeToRead; ++i)
-      bufferFIFO[i] = interface::Read();
-    if (CallbackCommandComplete) CallbackCommandComplete();
-  };
+  return Cm_PICC();
 }
 
-static void callbackWriteData(){
-  pinNSS::High();
-  if(interface::IsTxEmpty()){
-    interface::SetCountSendAtOnce(0);
-    interface::CallbackRxNotEmpty = nullptr;
-    if (CallbackEndTransmission) CallbackEndTransmission();
-  }
-  else pinNSS::Low();
-}
-
-static void WriteData(const uint8_t * data, size_t size, size_t countAtOnce){
-  pinNSS::Low();
-  interface::CallbackRxNotEmpty = callbackWriteData;
-  interface::SetCountSendAtOnce(countAtOnce);
-  interface::Write(data, size);
-}
-
-static void ReadData(const uint8_t * data, size_t size){
-  pinNSS::Low();
-  interface::CallbackRxNotEmpty = callbackWriteData;
-  interface::Push(data, size);
-  interface::Write(0);
-}
-
-static void ReadData(){
-  pinNSS::Low();
-  interface::CallbackRxNotEmpty = callbackWriteData;
-  interface::Write(0);
+static Task ReadFIFO(){
+  co_await _ReadFIFO();
+  _StoreFIFO();
+  if (CallbackCommandComplete) CallbackCommandComplete();
 }
 
 static void CalculateCRC(){
@@ -396,11 +358,78 @@ static void CalculateCRC(){
   sizeUsedFIFO += 2;
 }
 
-static inline void (*CallbackEndTransmission)() = nullptr; 
-
 static inline void (*CallbackCommandComplete)() = nullptr;
 
-static inline void (*CallbackInternalComplete)() = nullptr;
+private:
+
+  // Address and data of FIFO in one exchange
+static inline std::array<uint8_t, sizeExchangeMax> bufferTX;
+
+static inline std::atomic<void*> awaitingIRQ = nullptr;
+static inline std::atomic<bool> isIRQ = false;
+
+  // Data is exchanged in one frame of NSS. Coroutine is resumed, when all answer is received
+struct _Exchange{
+  decltype(interface::ReadExactly(size_t{})) read;
+
+  _Exchange(const uint8_t* data, size_t size): read(interface::ReadExactly(size)){
+    pinNSS::Low();
+    interface::FlushRX();
+    interface::Write(data, size);
+  }
+
+  bool await_ready(){ return read.await_ready(); }
+
+  bool await_suspend(std::coroutine_handle<> handle){ return read.await_suspend(handle); }
+
+  void await_resume(){
+    read.await_resume();
+    pinNSS::High();
+  }
+};
+
+  // IRQ is armed before command, so event before suspension is not lost
+static void _ArmIRQ(){
+  static_assert(!std::is_void_v<pinIRQ>, "Command requires IRQ pin");
+  isIRQ.store(false, std::memory_order_relaxed);
+  pinIRQ::CallbackEvent = _OnIRQ;
+}
+
+static void _OnIRQ(){
+  isIRQ.store(true, std::memory_order_release);
+  if (void* address = awaitingIRQ.exchange(nullptr, std::memory_order_acq_rel); address)
+    std::coroutine_handle<>::from_address(address).resume();
+}
+
+struct _AwaitIRQ{
+  bool await_ready(){ return isIRQ.load(std::memory_order_acquire); }
+
+  bool await_suspend(std::coroutine_handle<> handle){
+    awaitingIRQ.store(handle.address(), std::memory_order_release);
+    return !(isIRQ.load(std::memory_order_acquire) && awaitingIRQ.exchange(nullptr, std::memory_order_acq_rel));
+  }
+
+  void await_resume(){ pinIRQ::CallbackEvent = nullptr; }
+};
+
+static _Exchange _WriteFIFO(size_t size){
+  bufferTX[0] = registers::FIFODataReg;
+  for (size_t i = 0; i < size; ++i) bufferTX[i + 1] = bufferFIFO[i];
+  return _Exchange(bufferTX.data(), size + 1);
+}
+
+  // Each address reads next byte of FIFO, the last element only clocks out the last byte
+static _Exchange _ReadFIFO(){
+  for (size_t i = 0; i < sizeToRead; ++i) bufferTX[i] = registers::FIFODataReg | 0x80;
+  bufferTX[sizeToRead] = 0;
+  return _Exchange(bufferTX.data(), sizeToRead + 1);
+}
+
+static void _StoreFIFO(){
+  (void) interface::Read();
+  for(size_t i = 0; i < sizeToRead; ++i)
+    bufferFIFO[i] = interface::Read();
+}
 
 };
  
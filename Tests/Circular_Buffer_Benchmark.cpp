@@ -0,0 +1,102 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Benchmark of bulk Push/Pop of circular buffer against element loop. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include "../Containers/Circular_Buffer.hpp"
+#include "Test.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  static uint64_t _GetCycles(){ return __rdtsc(); }
+  static constexpr const char* unitCycles = "cycle";
+#else
+  static uint64_t _GetCycles(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+  static constexpr const char* unitCycles = "ns";
+#endif
+
+static constexpr size_t sizeBuffer = 8192;
+static constexpr size_t sizeMoved = 16 << 20;
+
+  // Element loop with wrap check on every element: Push/Pop before bulk paths
+struct LoopBuffer{
+  size_t head = 0;
+  size_t tail = 0;
+  size_t count = 0;
+  volatile uint8_t buffer[sizeBuffer] {};
+
+  bool Push(const uint8_t* elements, size_t length){
+    for (size_t i = 0; i < length; ++i){
+      buffer[tail] = elements[i];
+      tail = (tail + 1) & (sizeBuffer - 1);
+    }
+    count += length;
+    return true;
+  }
+
+  size_t Pop(uint8_t* destination, size_t length){
+    size_t currentHead = head;
+    if (length > count) length = count;
+    count -= length;
+    head = (head + length) & (sizeBuffer - 1);
+    for (size_t i = 0; i < length; ++i){
+      if (currentHead >= sizeBuffer) currentHead = 0;
+      destination[i] = buffer[currentHead++];
+    }
+    return length;
+  }
+};
+
+static uint8_t source[4096];
+static uint8_t destination[4096];
+
+  // Push and Pop of transfer. Odd offset of indexes makes transfers cross end of buffer.
+  // The best of runs is taken, so other load of host is not counted
+template<typename Buffer>
+static double Measure(Buffer& buffer, size_t length){
+  size_t iterations = sizeMoved / length;
+  double best = 0;
+  for (size_t run = 0; run < 5; ++run){
+    uint8_t offset[3];
+    buffer.Push(offset, 3);
+    buffer.Pop(offset, 3);
+    uint64_t start = _GetCycles();
+    for (size_t i = 0; i < iterations; ++i){
+      buffer.Push(source, length);
+      buffer.Pop(destination, length);
+    }
+    uint64_t cycles = _GetCycles() - start;
+    double result = double(iterations) * length / double(cycles);
+    if (result > best) best = result;
+  }
+  return best;
+}
+
+static container::CircularBuffer<uint8_t, sizeBuffer> bufferVolatile;
+static container::CircularBuffer<uint8_t, sizeBuffer, container::overflow::Overwrite, container::storage::Plain> bufferPlain;
+static LoopBuffer bufferLoop;
+
+int main(){
+  for (size_t i = 0; i < sizeof(source); ++i) source[i] = uint8_t(i * 7);
+  std::printf("Push + Pop of transfer, bytes/%s\n", unitCycles);
+  std::printf("%8s | %12s | %16s | %16s\n", "size", "element loop", "volatile bulk", "plain bulk");
+  for (size_t length : {1, 64, 4096}){
+    double loop = Measure(bufferLoop, length);
+    double segments = Measure(bufferVolatile, length);
+    double copy = Measure(bufferPlain, length);
+    std::printf("%8zu | %12.3f | %8.3f (x%4.1f) | %8.3f (x%4.1f)\n", length, loop, segments, segments/loop, copy, copy/loop);
+  }
+  TEST_CHECK(bufferVolatile.IsEmpty() && bufferPlain.IsEmpty());
+  TEST_CHECK(!memcmp(destination, source, sizeof(source)));
+  return test::Result("CircularBuffer benchmark");
+}
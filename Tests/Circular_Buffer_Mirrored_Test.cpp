@@ -0,0 +1,122 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Test of mirrored circular buffer: shadow copy and, with CIRCULAR_BUFFER_MIRROR_MMAP,
+//                memory mapped twice. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#include <cstdint>
+#include "../Containers/Circular_Buffer_Mirrored.hpp"
+#include "Test.hpp"
+
+using container::CircularBufferMirrored;
+
+  // Buffer is mapped twice, if size in bytes is multiple of page, otherwise shadow copy is used
+static bool _IsMapped(size_t sizeBytes){
+#if defined(CIRCULAR_BUFFER_MIRROR_MMAP) && defined(__linux__)
+  return !(sizeBytes % static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+#else
+  (void)sizeBytes;
+  return false;
+#endif
+}
+
+  // Elements are numbered in order of push, so each read checks position of data
+template<typename T>
+static bool _IsSequence(const T* data, size_t length, size_t first){
+  for (size_t i = 0; i < length; ++i)
+    if (data[i] != static_cast<T>(first + i)) return false;
+  return true;
+}
+
+template<typename T, size_t size, size_t sizeMirror>
+static void TestBuffer(){
+  static CircularBufferMirrored<T, size, sizeMirror> buffer;
+  static T source[size + 8];
+  static T destination[size + 8];
+  bool isMapped = _IsMapped(sizeof(T)*size);
+  size_t pushed = 0;
+  size_t popped = 0;
+  auto _Source = [&](size_t length){
+    for (size_t i = 0; i < length; ++i) source[i] = static_cast<T>(pushed + i);
+    pushed += length;
+    return source;
+  };
+    // Element is stored at index of its number, so head is known. 
+    // View over the wrap point is limited by sizeMirror for shadow copy
+  auto _CountView = [&](){
+    size_t countView = isMapped ? size : size - popped % size + sizeMirror;
+    return buffer.GetCount() < countView ? buffer.GetCount() : countView;
+  };
+
+  bool isPushed = true;
+  for (size_t i = 0; i < size - 3; ++i) isPushed &= buffer.Push(static_cast<T>(pushed++));
+  TEST_CHECK(isPushed);
+  TEST_CHECK(buffer.Pop(destination, size - 5) == size - 5);
+  TEST_CHECK(_IsSequence(destination, size - 5, popped));
+  popped += size - 5;
+
+    // Array is written over the wrap point: 3 elements before it, 5 after
+  TEST_CHECK(buffer.Push(_Source(8), 8));
+  TEST_CHECK(buffer.GetCount() == 10);
+  auto view = buffer.PeekRead();
+  TEST_CHECK(view.size == _CountView());
+  TEST_CHECK(_IsSequence(view.data, view.size, popped));
+  TEST_CHECK(buffer[9] == static_cast<T>(popped + 9));
+    // Pop copies all elements, also ones after the end of view
+  TEST_CHECK(buffer.Pop(destination, 12) == 10);
+  TEST_CHECK(_IsSequence(destination, 10, popped));
+  popped += 10;
+  TEST_CHECK(buffer.IsEmpty());
+
+    // Write in place over the wrap point: head is at size - 3, tail at size - 2
+  TEST_CHECK(buffer.Push(_Source(size - 7), size - 7));
+  buffer.ConsumeRead(size - 8);
+  popped += size - 8;
+  auto spans = buffer.ReserveWrite(6);
+  TEST_CHECK(spans.first.size == 2 && spans.second.size == 4);
+  for (size_t i = 0; i < spans.first.size; ++i) spans.first.data[i] = static_cast<T>(pushed++);
+  for (size_t i = 0; i < spans.second.size; ++i) spans.second.data[i] = static_cast<T>(pushed++);
+  buffer.CommitWrite(6);
+  view = buffer.PeekRead();
+  TEST_CHECK(view.size == _CountView());
+  TEST_CHECK(_IsSequence(view.data, view.size, popped));
+  TEST_CHECK(buffer.Pop(destination, 7) == 7);
+  TEST_CHECK(_IsSequence(destination, 7, popped));
+  popped += 7;
+
+    // Overflow: the oldest elements are overwritten, head follows tail
+  TEST_CHECK(buffer.Push(_Source(size - 2), size - 2));
+  TEST_CHECK(!buffer.Push(_Source(5), 5));
+  popped = pushed - size;
+  TEST_CHECK(buffer.GetCount() == size);
+  TEST_CHECK(buffer.Front() == static_cast<T>(popped));
+  TEST_CHECK(!buffer.Push(static_cast<T>(pushed++)));
+  popped++;
+  TEST_CHECK(buffer.Front() == static_cast<T>(popped));
+  view = buffer.PeekRead();
+  TEST_CHECK(view.size == _CountView());
+  TEST_CHECK(_IsSequence(view.data, view.size, popped));
+  TEST_CHECK(buffer.Pop(destination, size + 8) == size);
+  TEST_CHECK(_IsSequence(destination, size, popped));
+  TEST_CHECK(buffer.IsEmpty());
+
+    // Array longer than buffer: only its last elements are kept
+  TEST_CHECK(!buffer.Push(_Source(size + 3), size + 3));
+  popped = pushed - size;
+  TEST_CHECK(buffer.Front() == static_cast<T>(popped));
+  TEST_CHECK(buffer.Pop(destination, size + 8) == size);
+  TEST_CHECK(_IsSequence(destination, size, popped));
+}
+
+int main(){
+    // Page multiple: mapped twice with CIRCULAR_BUFFER_MIRROR_MMAP
+  TestBuffer<uint8_t, 4096, 4>();
+  TestBuffer<uint32_t, 1024, 16>();
+    // Shadow copy in both builds
+  TestBuffer<uint16_t, 100, 4>();
+  TestBuffer<uint8_t, 64, 64>();
+  return test::Result("Circular_Buffer_Mirrored_Test");
+}
@@ -0,0 +1,94 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Stress test of SPSC circular buffer: producer and consumer in two threads. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#include <cstdint>
+#include <thread>
+#include "../Containers/Circular_Buffer_SPSC.hpp"
+#include "Test.hpp"
+
+#ifndef SPSC_TEST_COUNT
+  #define SPSC_TEST_COUNT 4000000
+#endif
+
+  // Small buffer: indexes wrap often, producer and consumer meet on full and empty buffer
+static container::CircularBufferSPSC<uint32_t, 64> buffer;
+
+  // Producer writes increasing sequence by elements, arrays and in place
+static void Produce(){
+  uint32_t next = 0;
+  uint32_t array[24];
+  for (size_t step = 0; next < SPSC_TEST_COUNT; ++step){
+      // Thread without progress gives time to other one on single core host
+    if (!buffer.GetCountToOverflow()) std::this_thread::yield();
+    switch (step % 3){
+      case 0:
+        if (buffer.Push(next)) next++;
+        break;
+      case 1: {
+        size_t length = 1 + step % 24;
+        if (length > SPSC_TEST_COUNT - next) length = SPSC_TEST_COUNT - next;
+        size_t free = buffer.GetCountToOverflow();
+        if (length > free) length = free;
+        for (size_t i = 0; i < length; ++i) array[i] = next + i;
+        buffer.Push(array, length);
+        next += length;
+        break;
+      }
+      default: {
+        auto free = buffer.ReserveWrite(SPSC_TEST_COUNT - next < 32 ? SPSC_TEST_COUNT - next : 32);
+        size_t length = free.GetSize();
+        for (size_t i = 0; i < length; ++i) free[i] = next + i;
+        buffer.CommitWrite(length);
+        next += length;
+        break;
+      }
+    }
+  }
+}
+
+  // Consumer reads by elements, arrays and in place. Every element is checked: no loss, no duplicates
+static size_t Consume(){
+  uint32_t expected = 0;
+  size_t errors = 0;
+  uint32_t array[24];
+  for (size_t step = 0; expected < SPSC_TEST_COUNT; ++step){
+    if (buffer.IsEmpty()) std::this_thread::yield();
+    switch (step % 3){
+      case 0:
+        if (!buffer.IsEmpty()) errors += buffer.Pop() != expected++;
+        break;
+      case 1: {
+        size_t length = buffer.Pop(array, 1 + step % 24);
+        for (size_t i = 0; i < length; ++i) errors += array[i] != expected++;
+        break;
+      }
+      default: {
+        auto data = buffer.PeekRead();
+        size_t length = data.GetSize();
+        for (size_t i = 0; i < length; ++i) errors += data[i] != expected++;
+        buffer.ConsumeRead(length);
+        break;
+      }
+    }
+  }
+  return errors;
+}
+
+int main(){
+  size_t errors = 0;
+  std::thread consumer([&errors]{ errors = Consume(); });
+  std::thread producer(Produce);
+  producer.join();
+  consumer.join();
+  TEST_CHECK(errors == 0);
+  TEST_CHECK(buffer.IsEmpty());
+  TEST_CHECK(buffer.GetCount() == 0);
+    // Empty buffer: slot of the last element isn't read
+  TEST_CHECK(buffer.Pop() == 0);
+  return test::Result("CircularBufferSPSC");
+}
@@ -0,0 +1,154 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Test of coroutine awaitables of IConnection on simulated SPI and DMA. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#define STM32F10X_MD
+#define REGISTERS_SIMULATION
+
+#include <cstdint>
+#include "../Controllers/SPI/stm32f1_SPI.hpp"
+#include "../Controllers/SPI/stm32f1_SPI_Simulation.hpp"
+#include "../Utils/Coroutine.hpp"
+#include "Test.hpp"
+
+using namespace controller;
+using controller::hardware::simulation::Memory;
+using controller::hardware::simulation::SPIModel;
+using utils::coroutine::Task;
+using utils::coroutine::Frames;
+
+  // Tx buffer is less than written data, so data is pushed by parts from ISR
+using SPI = SPI1<16, 256>;
+
+static uint8_t data[100];
+static uint8_t received[100];
+static size_t step = 0;
+
+static void _Attach(){
+  Memory::Clear();
+  SPIModel::Attach(0x40013000, 0x40020000, 3, 2, {SPI::ISR, SPI::ISR_DMA_TX, SPI::ISR_DMA_RX});
+  SPI::Init();
+  SPI::FlushRX();
+  step = 0;
+}
+
+  // MISO is connected to MOSI: each written element is received back
+static Task Exchange(){
+  step = 1;
+  co_await SPI::Write({data, sizeof(data)});
+  step = 2;
+  co_await SPI::WaitIdle();
+  step = 3;
+  co_await SPI::ReadExactly(received, sizeof(received));
+  step = 4;
+}
+
+static void TestWriteRead(){
+  _Attach();
+  for (size_t i = 0; i < sizeof(data); ++i) data[i] = static_cast<uint8_t>(3*i + 1);
+  auto task = Exchange();
+  TEST_CHECK(static_cast<bool>(task));
+    // Coroutine waits for free space of tx buffer
+  TEST_CHECK(step == 1);
+  TEST_CHECK(Frames::GetUsed() == 1);
+  SPIModel::Run();
+  TEST_CHECK(step == 4);
+  TEST_CHECK(Frames::GetUsed() == 0);
+  bool isEqual = true;
+  for (size_t i = 0; i < sizeof(data); ++i) isEqual &= received[i] == data[i];
+  TEST_CHECK(isEqual);
+  TEST_CHECK(SPI::IsRxEmpty());
+}
+
+static Task Await(size_t count){
+  co_await SPI::ReadExactly(count);
+  step = count;
+}
+
+  // Awaiter of rx is resumed by ISR, when all elements are received, not at the first one
+static void TestReadExactly(){
+  _Attach();
+  Await(8);
+  TEST_CHECK(step == 0);
+  SPI::Write(data, 4);
+  SPIModel::Run();
+  TEST_CHECK(step == 0);
+  SPI::Write(data, 4);
+  SPIModel::Run();
+  TEST_CHECK(step == 8);
+  TEST_CHECK(SPI::GetRxCount() == 8);
+    // Data is ready: coroutine doesn't suspend
+  Await(8);
+  TEST_CHECK(Frames::GetUsed() == 0);
+}
+
+  // Handlers run inside await_suspend: on reads of DMA TX channel state, before and after handle is stored
+static size_t countRunsInSuspend = 0;
+static void _RunInSuspend(uint32_t, uint32_t){
+  if (!countRunsInSuspend) return;
+  countRunsInSuspend--;
+  SPIModel::Run();
+}
+
+static size_t countResumed = 0;
+static Task WriteTwice(){
+  co_await SPI::Write({data, 40});
+  countResumed++;
+  co_await SPI::Write({data + 40, 40});
+  countResumed++;
+}
+
+  // Coroutine is resumed once per await, even if it is resumed and awaits again before await_suspend returns
+static void TestResumeInSuspend(){
+  _Attach();
+  constexpr uint32_t addressCCRTX = 0x40020000 + 8 + 20*2;
+  Memory::GetRegister(addressCCRTX).CallbackRead = _RunInSuspend;
+  countResumed = 0;
+  countRunsInSuspend = 2;
+  WriteTwice();
+  SPIModel::Run();
+  Memory::GetRegister(addressCCRTX).CallbackRead = nullptr;
+  TEST_CHECK(countResumed == 2);
+  TEST_CHECK(Frames::GetUsed() == 0);
+  TEST_CHECK(SPI::GetRxCount() == 80);
+  bool isEqual = true;
+  for (size_t i = 0; i < 80; ++i) isEqual &= SPI::Read() == data[i];
+  TEST_CHECK(isEqual);
+}
+
+  // Coroutine is held till test resumes it
+struct Hold{
+  std::coroutine_handle<>& handle;
+  bool await_ready(){ return false; }
+  void await_suspend(std::coroutine_handle<> suspended){ handle = suspended; }
+  void await_resume(){}
+};
+
+static std::coroutine_handle<> held[COROUTINE_FRAMES + 1];
+
+static Task Wait(size_t index){ co_await Hold{held[index]}; }
+
+  // Frames are allocated from static pool: start fails, if pool is empty. Frame is released after completion
+static void TestFramePool(){
+  size_t started = 0;
+  for (size_t i = 0; i < COROUTINE_FRAMES + 1; ++i)
+    if (Wait(i)) started++;
+  TEST_CHECK(started == COROUTINE_FRAMES);
+  TEST_CHECK(Frames::GetUsed() == COROUTINE_FRAMES);
+  for (size_t i = 0; i < started; ++i) held[i].resume();
+  TEST_CHECK(Frames::GetUsed() == 0);
+  TEST_CHECK(static_cast<bool>(Wait(0)));
+  held[0].resume();
+}
+
+int main(){
+  TestWriteRead();
+  TestReadExactly();
+  TestResumeInSuspend();
+  TestFramePool();
+  return test::Result("Coroutine_Test");
+}
@@ -0,0 +1,151 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Test of DMA manager: conflicts of channels, shared channel with queue of transfers. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#define STM32F10X_MD
+#define REGISTERS_SIMULATION
+
+#include <cstdint>
+#include "../Controllers/DMA/stm32f1_DMA.hpp"
+#include "../Controllers/UART/stm32f1_UART.hpp"
+#include "../Controllers/SPI/stm32f1_SPI.hpp"
+#include "Test.hpp"
+
+using namespace controller;
+using controller::hardware::simulation::Memory;
+
+  // UART1 TX and SPI2 RX use DMA1 channel 4
+using UARTDMA = UART1<16, 16, configuration::uart::communication::txDMA_rxDMA>;
+using UARTISR = UART1<16, 16, configuration::uart::communication::txISR_rxISR>;
+using SPI2DMA = SPI2<16, 16, configuration::spi::communication::txDMA_rxDMA>;
+using SPI1DMA = SPI1<16, 16, configuration::spi::communication::txDMA_rxDMA>;
+
+static_assert(DMAManager::isConflict<UARTDMA, SPI2DMA>);
+static_assert(!DMAManager::isConflict<UARTISR, SPI2DMA>);
+static_assert(!DMAManager::isConflict<UARTDMA, SPI1DMA>);
+
+  // Channel 7 of DMA1 is not used by UART or SPI, so it is shared by transfers of test
+using Channel = DMAChannel<1, 7, 2>;
+using dma = DMA<1, 7>;
+
+static constexpr uint32_t addressISR = 0x40020000;
+static constexpr uint32_t addressIFCR = 0x40020004;
+static constexpr uint32_t addressCCR = 0x40020008 + 20*6;
+static constexpr uint32_t addressCNDTR = addressCCR + 4;
+static constexpr uint32_t addressCPAR = addressCCR + 8;
+static constexpr uint32_t addressCMAR = addressCCR + 12;
+static constexpr uint32_t flagsTC = 0x2U << 24;
+
+static uint8_t source[8];
+static uint8_t destination[4][8];
+static size_t order[8];
+static size_t countDone = 0;
+
+template<size_t index>
+static void _Done(){ order[countDone++] = index; }
+
+static constexpr uint32_t _Config(configuration::dma::priority pl){
+  return dma::valueConfig<configuration::dma::minc::MINC_Enabled, configuration::dma::pinc::PINC_Enabled,
+                          configuration::dma::dir::DIR_ToPeripheral, configuration::dma::circ::CIRC_Disabled,
+                          configuration::dma::isr::ISR_TC, configuration::dma::data_size::Size_8,
+                          configuration::dma::data_size::Size_8>
+         | static_cast<uint32_t>(pl);
+}
+
+  // Transfer complete: flag of channel is raised and interrupt is handled
+static void _Complete(){
+  Memory::Set(addressISR, flagsTC);
+  Channel::ISR();
+}
+
+static void _Attach(){
+  Memory::Clear();
+  Memory::Configure(addressIFCR).CallbackWrite = [](uint32_t, uint32_t value){
+    Memory::Set(addressISR, Memory::Get(addressISR) & ~value);
+  };
+  countDone = 0;
+}
+
+static void TestRequest(){
+  _Attach();
+  using configuration::dma::priority;
+  TEST_CHECK(Channel::Request({_Config(priority::Low), Memory::GetBusAddress(source), destination[0], 8, _Done<0>}));
+    // Channel is free: transfer starts at once from descriptor
+  TEST_CHECK(Channel::IsBusy());
+  TEST_CHECK(Channel::GetQueued() == 0);
+  TEST_CHECK(dma::IsEnabled());
+  TEST_CHECK((Memory::Read(addressCCR) & ~1U) == _Config(priority::Low));
+  TEST_CHECK(Memory::Read(addressCNDTR) == 8);
+  TEST_CHECK(Memory::Read(addressCPAR) == Memory::GetBusAddress(source));
+    // Memory is a pointer: bus address is taken on start, so host pointer of 64 bits isn't truncated
+  TEST_CHECK(Memory::Read(addressCMAR) == Memory::GetBusAddress(destination[0]));
+  TEST_CHECK(Memory::GetPointer(Memory::Read(addressCMAR)) == destination[0]);
+
+  _Complete();
+  TEST_CHECK(countDone == 1);
+  TEST_CHECK(!Channel::IsBusy());
+  TEST_CHECK(!dma::IsEnabled());
+  TEST_CHECK(!(Memory::Read(addressISR) & flagsTC));
+}
+
+static void TestPriority(){
+  _Attach();
+  using configuration::dma::priority;
+  TEST_CHECK(Channel::Request({_Config(priority::Low), 0, destination[0], 1, _Done<0>}));
+  TEST_CHECK(Channel::Request({_Config(priority::Low), 0, destination[1], 2, _Done<1>}));
+  TEST_CHECK(Channel::Request({_Config(priority::Low), 0, destination[2], 3, _Done<2>}));
+    // Queue of priority is full
+  TEST_CHECK(!Channel::Request({_Config(priority::Low), 0, destination[3], 4, _Done<3>}));
+  TEST_CHECK(Channel::Request({_Config(priority::VeryHigh), 0, destination[3], 4, _Done<3>}));
+  TEST_CHECK(Channel::GetQueued() == 3);
+
+    // Higher priority is started first, equal priorities - in order of request
+  _Complete();
+  TEST_CHECK(Memory::Read(addressCMAR) == Memory::GetBusAddress(destination[3]));
+  TEST_CHECK((Memory::Read(addressCCR) & ~1U) == _Config(priority::VeryHigh));
+  _Complete();
+  TEST_CHECK(Memory::Read(addressCNDTR) == 2);
+  _Complete();
+  _Complete();
+  TEST_CHECK(countDone == 4);
+  TEST_CHECK(order[0] == 0 && order[1] == 3 && order[2] == 1 && order[3] == 2);
+  TEST_CHECK(!Channel::IsBusy());
+  TEST_CHECK(Channel::GetQueued() == 0);
+}
+
+  // Callback is called from ISR: channel is free, so next transfer is requested by it
+static void _RequestNext(){
+  _Done<0>();
+  Channel::Request({_Config(configuration::dma::priority::Low), 0, destination[1], 5, _Done<1>});
+}
+
+static void TestAbort(){
+  _Attach();
+  using configuration::dma::circ;
+  Channel::Abort();
+  TEST_CHECK(countDone == 0);
+
+  uint32_t config = _Config(configuration::dma::priority::Medium) | static_cast<uint32_t>(circ::CIRC_Enabled);
+  TEST_CHECK(Channel::Request({config, 0, destination[0], 8, _RequestNext}));
+  TEST_CHECK(Channel::IsBusy());
+    // Circular transfer holds channel till Abort
+  Channel::Abort();
+  TEST_CHECK(countDone == 1);
+  TEST_CHECK(Channel::IsBusy());
+  TEST_CHECK(Memory::Read(addressCNDTR) == 5);
+  TEST_CHECK(!(Memory::Read(addressCCR) & static_cast<uint32_t>(circ::CIRC_Enabled)));
+  _Complete();
+  TEST_CHECK(countDone == 2 && order[1] == 1);
+  TEST_CHECK(!Channel::IsBusy());
+}
+
+int main(){
+  TestRequest();
+  TestPriority();
+  TestAbort();
+  return test::Result("DMA_Test");
+}
@@ -0,0 +1,174 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Test of IFramer protocols on host connection: decode, errors, overflow. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#include <cstdint>
+#include <initializer_list>
+#include "../Controllers/Interfaces/IConnection.hpp"
+#include "../Controllers/Interfaces/IFramer.hpp"
+#include "Test.hpp"
+
+using namespace controller::interfaces;
+
+  // Connection without hardware: received elements are pushed to rx buffer by test
+template<size_t rxSize, size_t id>
+struct Host: IConnection<uint8_t, 16, rxSize, controller::interface::UART, Host<rxSize, id>>{
+
+  using base = IConnection<uint8_t, 16, rxSize, controller::interface::UART, Host<rxSize, id>>;
+
+  static void Receive(std::initializer_list<uint8_t> data){
+    for (auto element : data) base::rxBuffer.Push(element);
+  }
+
+  static void Receive(uint8_t element, size_t count){
+    for (size_t i = 0; i < count; ++i) base::rxBuffer.Push(element);
+  }
+
+  static void _Send(){}
+  static void _CheckTxBuffer(){}
+  static void _CheckRxBuffer(){}
+  static bool Enqueue(const uint8_t*, size_t, void (*)()){ return false; }
+};
+
+template<typename framer, size_t size>
+static bool _IsFrame(const uint8_t (&expected)[size]){
+  if (!framer::Poll()) return false;
+  auto frame = framer::GetFrame();
+  if (frame.GetSize() != size) return false;
+  for (size_t i = 0; i < size; ++i)
+    if (frame[i] != expected[i]) return false;
+  framer::Release();
+  return true;
+}
+
+using HostCOBS = Host<512, 0>;
+using FramerCOBS = IFramer<HostCOBS, framing::COBS, 300>;
+
+static void TestCOBS(){
+    // Zeros of data are restored in place of codes
+  HostCOBS::Receive({0x02, 0x11, 0x03, 0x22, 0x33, 0x01, 0x00});
+  TEST_CHECK(_IsFrame<FramerCOBS>({0x11, 0x00, 0x22, 0x33, 0x00}));
+  TEST_CHECK(HostCOBS::IsRxEmpty());
+
+    // Block with code 0xFF has 254 elements and no implicit zero after it
+  HostCOBS::Receive(0xFF, 1);
+  HostCOBS::Receive(0x01, 254);
+  HostCOBS::Receive({0x02, 0x55, 0x00});
+  TEST_CHECK(FramerCOBS::Poll());
+  auto frame = FramerCOBS::GetFrame();
+  TEST_CHECK(frame.GetSize() == 255);
+  bool isEqual = frame.GetSize() == 255;
+  for (size_t i = 0; isEqual && i < 254; ++i) isEqual = frame[i] == 0x01;
+  TEST_CHECK(isEqual && frame[254] == 0x55);
+  FramerCOBS::Release();
+
+    // Zero inside block breaks frame, next frame is extracted
+  HostCOBS::Receive({0x05, 0x11, 0x22, 0x00, 0x02, 0x44, 0x00});
+  TEST_CHECK(_IsFrame<FramerCOBS>({0x44}));
+  TEST_CHECK(FramerCOBS::GetErrors() == 1);
+
+    // Empty frame is skipped
+  HostCOBS::Receive({0x01, 0x00});
+  TEST_CHECK(!FramerCOBS::Poll());
+  TEST_CHECK(HostCOBS::IsRxEmpty());
+  TEST_CHECK(FramerCOBS::GetErrors() == 1);
+}
+
+using HostSLIP = Host<32, 1>;
+using FramerSLIP = IFramer<HostSLIP, framing::SLIP, 8>;
+
+  // Rx buffer is written by ISR: frame keeps volatile access to elements
+static_assert(std::is_same_v<FramerSLIP::frame_t, container::Spans<const volatile uint8_t>>);
+
+static void TestSLIP(){
+  using framing::SLIP;
+  HostSLIP::Receive({0x01, SLIP::ESC, SLIP::ESC_END, 0x02, SLIP::ESC, SLIP::ESC_ESC, 0x03, SLIP::END});
+  TEST_CHECK(_IsFrame<FramerSLIP>({0x01, SLIP::END, 0x02, SLIP::ESC, 0x03}));
+  TEST_CHECK(HostSLIP::IsRxEmpty());
+
+    // Wrong escape: rest of frame is skipped till END, received part is dropped at once
+  HostSLIP::Receive({0x01, SLIP::ESC, 0x05, 0x02});
+  TEST_CHECK(!FramerSLIP::Poll());
+  TEST_CHECK(HostSLIP::IsRxEmpty());
+  HostSLIP::Receive({0x03, SLIP::END, 0x04, SLIP::END});
+  TEST_CHECK(_IsFrame<FramerSLIP>({0x04}));
+  TEST_CHECK(FramerSLIP::GetErrors() == 1);
+
+    // Frame longer than maxSize is skipped till END
+  HostSLIP::Receive(0x07, 9);
+  HostSLIP::Receive({SLIP::END, 0x08, SLIP::END});
+  TEST_CHECK(_IsFrame<FramerSLIP>({0x08}));
+  TEST_CHECK(FramerSLIP::GetErrors() == 2);
+  TEST_CHECK(HostSLIP::IsRxEmpty());
+}
+
+using HostLengthBE = Host<32, 2>;
+using FramerLengthBE = IFramer<HostLengthBE, framing::LengthPrefix<2, true>, 4>;
+using HostLengthLE = Host<32, 3>;
+using FramerLengthLE = IFramer<HostLengthLE, framing::LengthPrefix<2, false>, 4>;
+
+static void TestLengthPrefix(){
+    // Frame ends with the last data element: no delimiter
+  HostLengthBE::Receive({0x00, 0x03, 0xA1, 0xA2, 0xA3, 0x00, 0x01});
+  TEST_CHECK(_IsFrame<FramerLengthBE>({0xA1, 0xA2, 0xA3}));
+  TEST_CHECK(!FramerLengthBE::Poll());
+  HostLengthBE::Receive({0xB1});
+  TEST_CHECK(_IsFrame<FramerLengthBE>({0xB1}));
+
+    // Frame of zero length is skipped
+  HostLengthBE::Receive({0x00, 0x00, 0x00, 0x01, 0xC1});
+  TEST_CHECK(_IsFrame<FramerLengthBE>({0xC1}));
+  TEST_CHECK(FramerLengthBE::GetErrors() == 0);
+
+    // Length over maxSize: data is skipped till the last element of frame
+  HostLengthBE::Receive({0x00, 0x06, 1, 2, 3, 4, 5});
+  TEST_CHECK(!FramerLengthBE::Poll());
+  TEST_CHECK(FramerLengthBE::GetErrors() == 1);
+  HostLengthBE::Receive({6, 0x00, 0x01, 0xD1});
+  TEST_CHECK(_IsFrame<FramerLengthBE>({0xD1}));
+  TEST_CHECK(HostLengthBE::IsRxEmpty());
+
+  HostLengthLE::Receive({0x02, 0x00, 0xE1, 0xE2});
+  TEST_CHECK(_IsFrame<FramerLengthLE>({0xE1, 0xE2}));
+}
+
+using HostOverflow = Host<8, 4>;
+using FramerOverflow = IFramer<HostOverflow, framing::Delimiter<0x0A>, 7>;
+
+static void TestOverflow(){
+  HostOverflow::Receive({0x31, 0x32, 0x0A});
+  TEST_CHECK(FramerOverflow::Poll());
+    // Ready frame is overwritten on overflow of rx buffer: it is lost, not returned with wrong data
+  HostOverflow::Receive(0x33, 6);
+  TEST_CHECK(HostOverflow::GetRxDropped() == 1);
+  TEST_CHECK(FramerOverflow::GetFrame().GetSize() == 0);
+  TEST_CHECK(FramerOverflow::GetErrors() == 1);
+  TEST_CHECK(HostOverflow::GetRxCount() == 8);
+
+    // Lost frame isn't released: elements are dropped by flush
+  HostOverflow::FlushRX();
+  HostOverflow::Receive({0x34, 0x0A});
+  TEST_CHECK(_IsFrame<FramerOverflow>({0x34}));
+
+    // Overflow during scan is detected by Poll: scan starts again from new head
+  HostOverflow::Receive({0x35, 0x36});
+  TEST_CHECK(!FramerOverflow::Poll());
+  HostOverflow::Receive(0x37, 6);
+  HostOverflow::Receive({0x0A});
+  TEST_CHECK(HostOverflow::GetRxDropped() == 2);
+  TEST_CHECK(_IsFrame<FramerOverflow>({0x36, 0x37, 0x37, 0x37, 0x37, 0x37, 0x37}));
+  TEST_CHECK(FramerOverflow::GetErrors() == 2);
+  TEST_CHECK(HostOverflow::IsRxEmpty());
+}
+
+int main(){
+  TestCOBS();
+  TestSLIP();
+  TestLengthPrefix();
+  TestOverflow();
+  return test::Result("IFramer_Test");
+}
@@ -0,0 +1,212 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Test of MFRC522 coroutine commands on simulated SPI and chip. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#define STM32F10X_MD
+#define REGISTERS_SIMULATION
+
+#include <cstdint>
+#include "../Controllers/SPI/stm32f1_SPI.hpp"
+#include "../Controllers/SPI/stm32f1_SPI_Simulation.hpp"
+#include "../Devices/MFRC522/MFRC522.hpp"
+#include "Test.hpp"
+
+using namespace controller;
+using controller::hardware::simulation::Memory;
+using controller::hardware::simulation::SPIModel;
+using utils::coroutine::Frames;
+
+using SPI = SPI1<128, 128>;
+
+  // Registers of chip are addressed as in the first byte of frame: address << 1
+static constexpr uint8_t regCommand = 0x02;
+static constexpr uint8_t regFIFOData = 0x12;
+static constexpr uint8_t regFIFOLevel = 0x14;
+static constexpr uint8_t regBitFraming = 0x1A;
+static constexpr uint8_t regCRCResultH = 0x42;
+static constexpr uint8_t regCRCResultL = 0x44;
+static constexpr uint8_t regTPrescaler = 0x56;
+
+static constexpr uint8_t atqa[] = {0x04, 0x00};
+static constexpr uint8_t uid[] = {0x06, 0x87, 0xDB, 0x48, 0x12};
+
+  // Chip: the first byte of frame is address, next bytes are data of write or addresses of read
+struct Chip{
+  static inline uint8_t registers[64];
+  static inline uint8_t fifo[64];
+  static inline size_t sizeFIFO = 0;
+  static inline size_t indexFIFO = 0;
+  static inline uint8_t address = 0;
+  static inline bool isFirst = true;
+  static inline bool isRead = false;
+  static inline bool isIRQ = false;
+  static inline size_t countUnselected = 0;
+
+  static void Reset(){
+    for (auto& r : registers) r = 0;
+    sizeFIFO = indexFIFO = 0;
+    isFirst = true;
+    isIRQ = false;
+    countUnselected = 0;
+  }
+
+  static uint16_t Exchange(uint16_t frame);
+
+  static uint16_t CRC(){
+    uint32_t crc = 0x6363;
+    for (size_t i = 0; i < sizeFIFO; ++i){
+      uint8_t tmp = fifo[i] ^ (uint8_t)(crc & 0xFF);
+      tmp = tmp ^ (tmp << 4);
+      crc = (crc >> 8) ^ ((uint32_t)tmp << 8) ^ ((uint32_t)tmp << 3) ^ ((uint32_t)tmp >> 4);
+    }
+    return crc & 0xFFFF;
+  }
+
+  static void Answer(const uint8_t* data, size_t size){
+    for (size_t i = 0; i < size; ++i) fifo[i] = data[i];
+    sizeFIFO = size;
+    indexFIFO = 0;
+  }
+
+    // Transceive starts with StartSend bit of BitFramingReg. PICC answers to WUPA and anticollision
+  static void Transceive(){
+    if (fifo[0] == 0x52) Answer(atqa, sizeof(atqa));
+    else if (fifo[0] == 0x93 && fifo[1] == 0x20) Answer(uid, sizeof(uid));
+    else sizeFIFO = 0;
+    isIRQ = true;
+  }
+
+  static void Write(uint8_t reg, uint8_t value){
+    if (reg == regFIFOData){ if (sizeFIFO < sizeof(fifo)) fifo[sizeFIFO++] = value; return; }
+    if (reg == regFIFOLevel && (value & 0x80)){ sizeFIFO = indexFIFO = 0; return; }
+    registers[reg >> 1] = value;
+    if (reg == regCommand && value == 0x03){
+      uint16_t crc = CRC();
+      registers[regCRCResultL >> 1] = crc & 0xFF;
+      registers[regCRCResultH >> 1] = crc >> 8;
+      isIRQ = true;
+    }
+    if (reg == regBitFraming && (value & 0x80) && registers[regCommand >> 1] == 0x0C) Transceive();
+  }
+
+  static uint8_t Read(uint8_t reg){
+    if (reg == regFIFOData) return indexFIFO < sizeFIFO ? fifo[indexFIFO++] : 0;
+    return registers[reg >> 1];
+  }
+};
+
+struct PinNSS{
+  static inline bool isLow = false;
+  static inline size_t countSelected = 0;
+  static void Low(){ isLow = true; Chip::isFirst = true; countSelected++; }
+  static void High(){ isLow = false; }
+};
+
+struct PinIRQ{
+  static inline void (*CallbackEvent)() = nullptr;
+};
+
+uint16_t Chip::Exchange(uint16_t frame){
+  uint8_t byte = static_cast<uint8_t>(frame);
+  if (!PinNSS::isLow){ countUnselected++; return 0; }
+  if (isFirst){
+    isFirst = false;
+    isRead = byte & 0x80;
+    address = byte & 0x7E;
+    return 0;
+  }
+  if (!isRead){ Write(address, byte); return 0; }
+  uint8_t value = Read(address);
+  address = byte & 0x7E;
+  return value;
+}
+
+using RFID = device::MFRC522<SPI, PinNSS, PinIRQ>;
+
+static size_t countComplete = 0;
+static void _Complete(){ countComplete++; }
+
+static void _Attach(){
+  Memory::Clear();
+  SPIModel::Attach(0x40013000, 0x40020000, 3, 2, {SPI::ISR, SPI::ISR_DMA_TX, SPI::ISR_DMA_RX}, Chip::Exchange);
+  SPI::Init();
+  SPI::FlushRX();
+  Chip::Reset();
+  PinNSS::countSelected = 0;
+  countComplete = 0;
+  RFID::CallbackCommandComplete = _Complete;
+}
+
+  // Bus is run till chip raises IRQ, that resumes coroutine of command
+static void _Run(){
+  for (size_t i = 0; i < 16; ++i){
+    SPIModel::Run();
+    if (!Chip::isIRQ) return;
+    Chip::isIRQ = false;
+    if (PinIRQ::CallbackEvent) PinIRQ::CallbackEvent();
+  }
+}
+
+static void TestInit(){
+  _Attach();
+  TEST_CHECK(static_cast<bool>(RFID::Init()));
+  _Run();
+    // Each register is written in own frame of NSS
+  TEST_CHECK(PinNSS::countSelected == 7);
+  TEST_CHECK(!PinNSS::isLow);
+  TEST_CHECK(Chip::registers[regTPrescaler >> 1] == 0xA9);
+  TEST_CHECK(Chip::registers[regCommand >> 1] == 0x0F);
+  TEST_CHECK(Chip::countUnselected == 0);
+  TEST_CHECK(Frames::GetUsed() == 0);
+}
+
+static void TestCalculateCRC(){
+  _Attach();
+  const uint8_t data[] = {0x93, 0x70, 0x06, 0x87, 0xDB, 0x48, 0x12};
+  for (size_t i = 0; i < sizeof(data); ++i) RFID::bufferFIFO[i] = data[i];
+  TEST_CHECK(static_cast<bool>(RFID::CalculateCRC1(sizeof(data))));
+    // Coroutine waits for IRQ of chip
+  SPIModel::Run();
+  TEST_CHECK(PinIRQ::CallbackEvent != nullptr);
+  TEST_CHECK(countComplete == 0);
+  TEST_CHECK(Frames::GetUsed() == 1);
+  _Run();
+  TEST_CHECK(countComplete == 1);
+  TEST_CHECK(PinIRQ::CallbackEvent == nullptr);
+  uint16_t crc = Chip::CRC();
+  TEST_CHECK(RFID::bufferFIFO[2] == (crc & 0xFF) && RFID::bufferFIFO[3] == (crc >> 8));
+  TEST_CHECK(Chip::countUnselected == 0);
+  TEST_CHECK(Frames::GetUsed() == 0);
+}
+
+static void TestPICC(){
+  _Attach();
+  TEST_CHECK(static_cast<bool>(RFID::SetPICCtoReady()));
+  _Run();
+  TEST_CHECK(countComplete == 1);
+  TEST_CHECK(RFID::bufferFIFO[0] == 0x04 && RFID::bufferFIFO[1] == 0x00);
+    // 7 bits of the last byte for short frame of WUPA
+  TEST_CHECK(Chip::registers[regBitFraming >> 1] == 0x87);
+
+  TEST_CHECK(static_cast<bool>(RFID::GetUID()));
+  _Run();
+  TEST_CHECK(countComplete == 2);
+  bool isEqual = true;
+  for (size_t i = 0; i < sizeof(uid); ++i) isEqual &= RFID::bufferFIFO[i] == uid[i];
+  TEST_CHECK(isEqual);
+  TEST_CHECK(!PinNSS::isLow);
+  TEST_CHECK(Chip::countUnselected == 0);
+  TEST_CHECK(SPI::IsRxEmpty());
+  TEST_CHECK(Frames::GetUsed() == 0);
+}
+
+int main(){
+  TestInit();
+  TestCalculateCRC();
+  TestPICC();
+  return test::Result("MFRC522_Test");
+}
@@ -0,0 +1,229 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Test of Registers on simulated address space: coalescing and bit-band. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#define STM32F10X_MD
+#define REGISTERS_SIMULATION
+#define REGISTERS_TRACE
+
+#include <cstdint>
+#include "../Controllers/Common/Core/Registers.hpp"
+#include "../Controllers/Pin/stm32f1_Pin.hpp"
+#include "../Controllers/Pinlist/stm32f1_Pinlist.hpp"
+#include "../Controllers/Power/stm32f1_Power.hpp"
+#include "../Controllers/Common/Core/Interrupt.hpp"
+#include "Test.hpp"
+
+using namespace controller::hardware;
+using trait::Valuelist;
+
+  // Registers outside of bit-band region: every access is visible in trace
+static constexpr uint32_t addressA = 0x50000000;
+static constexpr uint32_t addressB = 0x50000004;
+
+  // Registers of bit-band regions: peripherals and SRAM
+static constexpr uint32_t addressPeripheral = 0x40010804;
+static constexpr uint32_t addressSRAM = 0x20000010;
+
+static constexpr uint32_t _GetAlias(uint32_t address, uint32_t bit){
+  return (address & 0xF0000000) + 0x02000000 + ((address & 0xFFFFF) << 5) + (bit << 2);
+}
+
+struct Access: Registers{
+  template<typename addresses, typename values, typename masks = values>
+  static void Set(){ _Set<addresses, values, masks>(); }
+
+  template<typename addresses, typename values, typename masks = values>
+  static void Write(){ _Write<addresses, values, masks>(); }
+
+  template<auto address, auto value, auto mask>
+  static void Set(){ _Set<address, value, mask>(); }
+
+  template<auto address, auto mask>
+  static void Set(uint32_t value){ _Set<address, mask>(value); }
+
+  template<auto address, auto value>
+  static void Clear(){ _Clear<address, value>(); }
+};
+
+static void _Reset(){
+  simulation::Memory::Clear();
+  trace::Trace::Reset();
+}
+
+static bool _IsRecord(size_t index, trace::access access, uint32_t address, uint32_t value, uint32_t mask){
+  auto record = trace::Trace::GetRecord(index);
+  return record.access == access && record.address == address && record.value == value && record.mask == mask;
+}
+
+  // Modification of other register between accesses to the same one keeps order
+static void TestOrder(){
+  _Reset();
+  simulation::Memory::Set(addressA, 0xF0);
+  Access::Set<Valuelist<addressA, addressB, addressA>, 
+              Valuelist<0x00U, 0x30U, 0x03U>,
+              Valuelist<0x0FU, 0x30U, 0x03U>>();
+  TEST_CHECK(trace::Trace::GetRecordsCount() == 3);
+  TEST_CHECK(_IsRecord(0, trace::access::ReadModifyWrite, addressA, 0x00, 0x0F));
+  TEST_CHECK(_IsRecord(1, trace::access::ReadModifyWrite, addressB, 0x30, 0x30));
+  TEST_CHECK(_IsRecord(2, trace::access::ReadModifyWrite, addressA, 0x03, 0x03));
+  TEST_CHECK(simulation::Memory::Get(addressA) == 0xF3);
+  TEST_CHECK(simulation::Memory::Get(addressB) == 0x30);
+}
+
+  // Key sequence: every store reaches register
+static void TestRepeatedStores(){
+  _Reset();
+  Access::Write<Valuelist<addressA, addressA>, Valuelist<0x45670123U, 0xCDEF89ABU>>();
+  TEST_CHECK(trace::Trace::GetRecordsCount() == 2);
+  TEST_CHECK(_IsRecord(0, trace::access::Write, addressA, 0x45670123, ~0U));
+  TEST_CHECK(_IsRecord(1, trace::access::Write, addressA, 0xCDEF89AB, ~0U));
+
+  _Reset();
+  Access::Set<Valuelist<addressA, addressA>, Valuelist<0x1U, 0x2U>, Valuelist<~0U, ~0U>>();
+  TEST_CHECK(trace::Trace::GetRecordsCount() == 2);
+  TEST_CHECK(_IsRecord(0, trace::access::Write, addressA, 0x1, ~0U));
+  TEST_CHECK(_IsRecord(1, trace::access::Write, addressA, 0x2, ~0U));
+}
+
+  // Adjacent modifications of the same register are one read-modify-write
+static void TestMergeAdjacent(){
+  _Reset();
+  simulation::Memory::Set(addressA, 0xFF);
+  Access::Set<Valuelist<addressA, addressA, addressA>, 
+              Valuelist<0x01U, 0x00U, 0x40U>, 
+              Valuelist<0x03U, 0x10U, 0x41U>>();
+  TEST_CHECK(trace::Trace::GetRecordsCount() == 1);
+  TEST_CHECK(_IsRecord(0, trace::access::ReadModifyWrite, addressA, 0x40, 0x53));
+  TEST_CHECK(simulation::Memory::Get(addressA) == 0xEC);
+}
+
+  // Modification after store isn't merged to it, full-mask modification is store, no-op is dropped
+static void TestStoreAndNoOp(){
+  _Reset();
+  simulation::Memory::Set(addressB, 0xFF);
+  Access::Set<Valuelist<addressA, addressA, addressB, addressB>, 
+              Valuelist<0x12U, 0x100U, 0x00U, 0x00U>, 
+              Valuelist<~0U, 0x100U, 0x00U, 0x0FU>>();
+  TEST_CHECK(trace::Trace::GetRecordsCount() == 3);
+  TEST_CHECK(_IsRecord(0, trace::access::Write, addressA, 0x12, ~0U));
+  TEST_CHECK(_IsRecord(1, trace::access::ReadModifyWrite, addressA, 0x100, 0x100));
+  TEST_CHECK(_IsRecord(2, trace::access::ReadModifyWrite, addressB, 0x00, 0x0F));
+  TEST_CHECK(simulation::Memory::Get(addressA) == 0x112);
+  TEST_CHECK(simulation::Memory::Get(addressB) == 0xF0);
+}
+
+  // Stores to alias are mapped to bits of target word
+static void TestBitBandAlias(){
+  _Reset();
+  for (uint32_t address : {addressPeripheral, addressSRAM}){
+    simulation::Memory::Set(address, 0x0F0F0F0F);
+    for (uint32_t bit = 0; bit < 32; ++bit){
+      uint32_t before = simulation::Memory::Get(address);
+      simulation::Memory::Write(_GetAlias(address, bit), ~before >> bit);
+      TEST_CHECK(simulation::Memory::Get(address) == (before ^ (1U << bit)));
+      TEST_CHECK(simulation::Memory::Read(_GetAlias(address, bit)) == ((~before >> bit) & 1U));
+    }
+  }
+}
+
+  // Single-bit modification of bit-band region is one store, other bits are kept
+static void TestBitBand(){
+  _Reset();
+  simulation::Memory::Set(addressPeripheral, 0xA5);
+  Access::Set<addressPeripheral, 0x100U, 0x100U>();
+  Access::Clear<addressPeripheral, 0x4U>();
+  Access::Set<addressPeripheral, 0x80000000U>(0x80000000U);
+  TEST_CHECK(trace::Trace::GetRecordsCount() == 3);
+  TEST_CHECK(_IsRecord(0, trace::access::Write, addressPeripheral, 0x100, 0x100));
+  TEST_CHECK(_IsRecord(1, trace::access::Write, addressPeripheral, 0, 0x4));
+  TEST_CHECK(_IsRecord(2, trace::access::Write, addressPeripheral, 0x80000000, 0x80000000));
+  TEST_CHECK(simulation::Memory::Get(addressPeripheral) == 0x800001A1);
+}
+
+  // Value with bits outside of mask keeps semantics of read-modify-write
+static void TestBitBandValueOutsideMask(){
+  _Reset();
+  simulation::Memory::Set(addressPeripheral, 0x0);
+  Access::Set<addressPeripheral, 0x3U, 0x1U>();
+  TEST_CHECK(_IsRecord(0, trace::access::ReadModifyWrite, addressPeripheral, 0x3, 0x1));
+  TEST_CHECK(simulation::Memory::Get(addressPeripheral) == 0x3);
+  Access::Set<addressPeripheral, 0x10U>(0x30U);
+  TEST_CHECK(_IsRecord(1, trace::access::ReadModifyWrite, addressPeripheral, 0x30, 0x10));
+  TEST_CHECK(simulation::Memory::Get(addressPeripheral) == 0x33);
+  Access::Set<addressPeripheral, 0x10U>(0x0U);
+  TEST_CHECK(_IsRecord(2, trace::access::Write, addressPeripheral, 0, 0x10));
+  TEST_CHECK(simulation::Memory::Get(addressPeripheral) == 0x23);
+}
+
+  // Bus cycles of drivers: what ISR pays for pins, interrupts and clocks
+
+  // Pinlist is written by one store to BSRR per port: set and reset bits at once
+static void TestPinlistWrite(){
+  _Reset();
+  using List = controller::Pinlist<controller::Pin::PA_0, controller::Pin::PA_1, 
+                                   controller::Pin::PB_5, controller::Pin::PA_7>;
+  List::Write(0b1011);
+  TEST_CHECK(trace::Trace::GetCount() == 2);
+  TEST_CHECK(trace::Trace::GetBusCycles() == 2);
+  TEST_CHECK(_IsRecord(0, trace::access::Write, 0x40010810, 0x00830081, ~0U));
+  TEST_CHECK(_IsRecord(1, trace::access::Write, 0x40010C10, 0x00200020, ~0U));
+
+  _Reset();
+  List::Write<0b0101>();
+  TEST_CHECK(trace::Trace::GetBusCycles() == 2);
+  TEST_CHECK(_IsRecord(0, trace::access::Write, 0x40010810, 0x00830082, ~0U));
+  TEST_CHECK(_IsRecord(1, trace::access::Write, 0x40010C10, 0x00200000, ~0U));
+}
+
+  // Interrupts of one ISER register are enabled by one store, registers without interrupts are not accessed
+struct PeripheralIRQ{
+  struct initialization{ using interrupts = Valuelist<37U, 38U, 71U>; };
+};
+
+static void TestInterruptEnable(){
+  _Reset();
+  controller::Interrupt::Enable<PeripheralIRQ>();
+  TEST_CHECK(trace::Trace::GetCount() == 2);
+  TEST_CHECK(trace::Trace::GetBusCycles() == 2);
+  TEST_CHECK(_IsRecord(0, trace::access::Write, 0xE000E104, 0x60, ~0U));
+  TEST_CHECK(_IsRecord(1, trace::access::Write, 0xE000E108, 0x80, ~0U));
+
+  _Reset();
+  controller::Interrupt::Disable<PeripheralIRQ>();
+  TEST_CHECK(trace::Trace::GetBusCycles() == 2);
+  TEST_CHECK(_IsRecord(0, trace::access::Write, 0xE000E184, 0x60, ~0U));
+}
+
+  // Single clock bit is one bit-band store, several bits - read-modify-write, empty register is skipped
+static void TestPowerEnable(){
+  _Reset();
+  using controller::Power;
+  Power::Enable<Power::fromValues<0, 0x4000, 0>, Power::fromValues<0, 0, 0x4004>>();
+  TEST_CHECK(trace::Trace::GetCount() == 2);
+  TEST_CHECK(trace::Trace::GetBusCycles() == 3);
+  TEST_CHECK(_IsRecord(0, trace::access::Write, 0x4002101C, 0x4000, 0x4000));
+  TEST_CHECK(_IsRecord(1, trace::access::ReadModifyWrite, 0x40021018, 0x4004, 0x4004));
+  TEST_CHECK(trace::Trace::GetCounter(0x40021018).GetBusCycles() == 2);
+  TEST_CHECK(trace::Trace::GetCounter(0x40021014).GetBusCycles() == 0);
+  TEST_CHECK(simulation::Memory::Get(0x4002101C) == 0x4000);
+  TEST_CHECK(simulation::Memory::Get(0x40021018) == 0x4004);
+}
+
+int main(){
+  TestOrder();
+  TestRepeatedStores();
+  TestMergeAdjacent();
+  TestStoreAndNoOp();
+  TestBitBandAlias();
+  TestBitBand();
+  TestBitBandValueOutsideMask();
+  TestPinlistWrite();
+  TestInterruptEnable();
+  TestPowerEnable();
+  return test::Result("Registers");
+}
@@ -0,0 +1,68 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Benchmark of communication modes of SPI driver on simulated SPI and DMA. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#define STM32F10X_MD
+#define REGISTERS_SIMULATION
+#define REGISTERS_TRACE
+
+#include <cstdint>
+#include <cstdio>
+#include "../Controllers/SPI/stm32f1_SPI.hpp"
+#include "../Controllers/SPI/stm32f1_SPI_Simulation.hpp"
+#include "Test.hpp"
+
+using namespace controller;
+using namespace controller::configuration::spi;
+using controller::hardware::simulation::Memory;
+using controller::hardware::simulation::SPIModel;
+using controller::hardware::trace::Trace;
+
+static constexpr uint32_t addressSPI1 = 0x40013000;
+static constexpr uint32_t addressDMA1 = 0x40020000;
+static constexpr size_t sizeMax = 4096;
+static constexpr size_t sizes[] = {1, 4, 16, 64, 256, 1024, 4096};
+
+static uint8_t data[sizeMax];
+static uint8_t received[sizeMax];
+
+  // Each transfer is written to tx buffer of stream and read back from rx buffer: MISO is connected to MOSI
+template<communication comm>
+static void Benchmark(const char* name){
+  using SPI = SPI1<sizeMax, sizeMax, comm>;
+  Memory::Clear();
+  Trace::Reset();
+  SPIModel::Attach(addressSPI1, addressDMA1, 3, 2, {SPI::ISR, SPI::ISR_DMA_TX, SPI::ISR_DMA_RX});
+  SPI::Init();
+  std::printf("%s\n", name);
+  std::printf("    size | interrupts/transfer | accesses/byte | accesses in ISR/byte | ISR bus cycles/transfer\n");
+  for (auto size : sizes){
+    SPI::FlushRX();
+    SPIModel::ResetStatistics();
+    size_t accesses = Trace::GetCount();
+    bool isWritten = SPI::Write(data, size);
+    auto& statistics = SPIModel::Run();
+    accesses = Trace::GetCount() - accesses;
+    bool isReceived = SPI::Read(received, size) == size;
+    for (size_t i = 0; isReceived && i < size; ++i) isReceived = received[i] == data[i];
+    TEST_CHECK(isWritten && isReceived && statistics.frames == size && !statistics.overruns);
+    std::printf("%8zu | %19zu | %13.2f | %20.2f | %23zu\n", size, statistics.GetInterrupts(),
+                double(accesses) / size, double(statistics.accessesISR) / size, statistics.busCyclesISR);
+  }
+  std::printf("\n");
+}
+
+int main(){
+  for (size_t i = 0; i < sizeMax; ++i) data[i] = static_cast<uint8_t>(i * 7 + 1);
+  std::printf("SPI1 master, 8-bit frames, one transfer of stream(Write and Run). ");
+  std::printf("Bus cycles are register accesses, read-modify-write costs 2\n\n");
+  Benchmark<communication::txDMA_rxDMA>("txDMA_rxDMA");
+  Benchmark<communication::txISR_rxISR>("txISR_rxISR");
+  Benchmark<communication::txDMA_rxISR>("txDMA_rxISR");
+  Benchmark<communication::txISR_rxDMA>("txISR_rxDMA");
+  return test::Result("SPI benchmark");
+}
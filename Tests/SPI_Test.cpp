@@ -0,0 +1,283 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Test of SPI driver on simulated SPI and DMA: stream, transactions, frequency. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#define STM32F10X_MD
+#define REGISTERS_SIMULATION
+
+#include <cstdint>
+#include "../Controllers/SPI/stm32f1_SPI.hpp"
+#include "../Controllers/SPI/stm32f1_SPI_Simulation.hpp"
+#include "Test.hpp"
+
+using namespace controller;
+using namespace controller::configuration::spi;
+using controller::hardware::simulation::Memory;
+using controller::hardware::simulation::SPIModel;
+
+static constexpr uint32_t addressSPI1 = 0x40013000;
+static constexpr uint32_t addressDMA1 = 0x40020000;
+static constexpr uint32_t addressCR1 = addressSPI1;
+
+using SPI = SPI1<64, 64>;
+using SPI16 = SPI1<64, 64, communication::txDMA_rxDMA, divisor::DIVISOR_128, remap::None, frame_size::FRAME_16_BIT>;
+using SPISmall = SPI1<16, 64>;
+
+  // Slave answers with inverted frame
+static uint16_t _Invert(uint16_t frame){ return ~frame; }
+
+  // Chip select is modeled by pin with counters of edges
+struct PinCS{
+  static inline bool isLow = false;
+  static inline size_t countSelected = 0;
+  static void Low(){ isLow = true; countSelected++; }
+  static void High(){ isLow = false; }
+};
+
+static size_t countCallbacks = 0;
+static void _Callback(){ countCallbacks++; }
+
+template<typename spi>
+static void _Attach(uint16_t (*device)(uint16_t) = nullptr){
+  Memory::Clear();
+  SPIModel::Attach(addressSPI1, addressDMA1, 3, 2, {spi::ISR, spi::ISR_DMA_TX, spi::ISR_DMA_RX}, device);
+}
+
+static void TestStream(){
+  _Attach<SPI>();
+  SPI::Init();
+  const uint8_t data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  TEST_CHECK(SPI::Write(data, sizeof(data)));
+  auto& statistics = SPIModel::Run();
+  TEST_CHECK(statistics.frames == sizeof(data));
+  TEST_CHECK(statistics.overruns == 0);
+  TEST_CHECK(SPI::GetRxCount() == sizeof(data));
+  uint8_t received[sizeof(data)] {};
+  TEST_CHECK(SPI::Read(received, sizeof(received)) == sizeof(data));
+  for (size_t i = 0; i < sizeof(data); ++i) TEST_CHECK(received[i] == data[i]);
+}
+
+  // Elements sent by DMA stay in tx buffer till transfer is complete, so write over them is dropped
+static void TestTxInFlight(){
+  _Attach<SPISmall>();
+  SPISmall::Init();
+  uint8_t first[16];
+  uint8_t second[4] = {0xA0, 0xA1, 0xA2, 0xA3};
+  for (size_t i = 0; i < sizeof(first); ++i) first[i] = static_cast<uint8_t>(i + 1);
+  TEST_CHECK(SPISmall::Write(first, sizeof(first)));
+  SPIModel::Step();
+  TEST_CHECK(SPISmall::GetTxCount() == sizeof(first));
+  TEST_CHECK(!SPISmall::Write(second, sizeof(second)));
+  SPIModel::Run();
+  TEST_CHECK(SPISmall::IsTxEmpty());
+  TEST_CHECK(SPISmall::Write(second, sizeof(second)));
+  SPIModel::Run();
+  uint8_t received[sizeof(first) + sizeof(second)] {};
+  TEST_CHECK(SPISmall::Read(received, sizeof(received)) == sizeof(received));
+  bool isEqual = true;
+  for (size_t i = 0; i < sizeof(first); ++i) isEqual &= received[i] == first[i];
+  for (size_t i = 0; i < sizeof(second); ++i) isEqual &= received[sizeof(first) + i] == second[i];
+  TEST_CHECK(isEqual);
+}
+
+static void TestTransaction(){
+  _Attach<SPI>(_Invert);
+  SPI::Init();
+  countCallbacks = 0;
+  PinCS::countSelected = 0;
+  const uint8_t tx[] = {0x00, 0x0F, 0xF0};
+  uint8_t rx[3] {};
+  TEST_CHECK(SPI::Transaction<PinCS>({tx, 3}, {rx, 3}, _Callback));
+  TEST_CHECK(SPI::IsTransactionBusy());
+  TEST_CHECK(PinCS::isLow);
+  SPIModel::Run();
+  TEST_CHECK(!SPI::IsTransactionBusy());
+  TEST_CHECK(!PinCS::isLow);
+  TEST_CHECK(PinCS::countSelected == 1);
+  TEST_CHECK(countCallbacks == 1);
+  TEST_CHECK(rx[0] == 0xFF && rx[1] == 0xF0 && rx[2] == 0x0F);
+    // Transaction doesn't add data to stream
+  TEST_CHECK(SPI::IsRxEmpty());
+}
+
+static void TestTransactionQueue(){
+  _Attach<SPI>(_Invert);
+  SPI::Init();
+  countCallbacks = 0;
+  PinCS::countSelected = 0;
+  const uint8_t first[] = {1, 2};
+  const uint8_t second[] = {3, 4, 5};
+  uint8_t rxFirst[2] {};
+  uint8_t rxSecond[3] {};
+  TEST_CHECK(SPI::Transaction<PinCS>({first, 2}, {rxFirst, 2}, _Callback));
+  TEST_CHECK(SPI::Transaction<PinCS>({second, 3}, {rxSecond, 3}, _Callback));
+  auto& statistics = SPIModel::Run();
+  TEST_CHECK(statistics.frames == 5);
+  TEST_CHECK(countCallbacks == 2);
+  TEST_CHECK(PinCS::countSelected == 2);
+  TEST_CHECK(rxFirst[0] == 0xFE && rxFirst[1] == 0xFD);
+  TEST_CHECK(rxSecond[0] == 0xFC && rxSecond[2] == 0xFA);
+    // Size of rx is less than tx
+  TEST_CHECK(!SPI::Transaction({first, 2}, {rxSecond, 1}));
+  TEST_CHECK(!SPI::Transaction({}, {}));
+}
+
+  // Write-only transaction discards received data, read-only one sends dummy element
+static uint8_t lastMOSI = 0;
+static uint16_t _Record(uint16_t frame){ lastMOSI = static_cast<uint8_t>(frame); return 0x5A; }
+
+static void TestDummyAndSink(){
+  _Attach<SPI>(_Record);
+  SPI::Init();
+  const uint8_t tx[] = {0x11, 0x22, 0x33, 0x44};
+  TEST_CHECK(SPI::Transaction({tx, sizeof(tx)}));
+  auto& statistics = SPIModel::Run();
+  TEST_CHECK(statistics.frames == sizeof(tx));
+  TEST_CHECK(lastMOSI == 0x44);
+  TEST_CHECK(SPI::IsRxEmpty());
+
+  SPI::SetDummy(0xA7);
+  uint8_t rx[4] {};
+  TEST_CHECK(SPI::Transaction({}, {rx, sizeof(rx)}));
+  SPIModel::Run();
+  TEST_CHECK(statistics.frames == 2*sizeof(rx));
+  TEST_CHECK(lastMOSI == 0xA7);
+  TEST_CHECK(rx[0] == 0x5A && rx[3] == 0x5A);
+    // Stream continues with DMA configuration of stream after transactions
+  const uint8_t data[] = {9, 8};
+  TEST_CHECK(SPI::Write(data, 2));
+  SPIModel::Run();
+  TEST_CHECK(lastMOSI == 8);
+  TEST_CHECK(SPI::GetRxCount() == 2);
+}
+
+  // Stream DMA interrupts are raised inside dispatch of transaction: on the first read of DMA TX channel state
+static bool isHookArmed = false;
+static void _RunInDispatch(uint32_t, uint32_t){
+  if (!isHookArmed) return;
+  isHookArmed = false;
+  SPIModel::Run();
+}
+
+static void TestTransactionDuringStream(){
+  _Attach<SPI>(_Invert);
+  SPI::Init();
+  constexpr uint32_t addressCCRTX = addressDMA1 + 8 + 20*2;
+  Memory::GetRegister(addressCCRTX).CallbackRead = _RunInDispatch;
+  SPI::FlushRX();
+  countCallbacks = 0;
+  PinCS::countSelected = 0;
+  const uint8_t stream[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const uint8_t tx[] = {0x10, 0x20, 0x30};
+  uint8_t rx[3] {};
+  TEST_CHECK(SPI::Write(stream, sizeof(stream)));
+  SPIModel::Step();
+  SPIModel::Step();
+  isHookArmed = true;
+  TEST_CHECK(SPI::Transaction<PinCS>({tx, 3}, {rx, 3}, _Callback));
+  TEST_CHECK(!isHookArmed);
+  SPIModel::Run();
+    // Stream is complete, transaction runs once after it
+  TEST_CHECK(SPI::IsTxEmpty());
+  TEST_CHECK(SPI::GetRxCount() == sizeof(stream));
+  TEST_CHECK(countCallbacks == 1);
+  TEST_CHECK(PinCS::countSelected == 1 && !PinCS::isLow);
+  TEST_CHECK(rx[0] == 0xEF && rx[1] == 0xDF && rx[2] == 0xCF);
+  TEST_CHECK(!SPI::IsTransactionBusy());
+  uint8_t received[sizeof(stream)] {};
+  SPI::Read(received, sizeof(received));
+  bool isEqual = true;
+  for (size_t i = 0; i < sizeof(stream); ++i) isEqual &= received[i] == static_cast<uint8_t>(~stream[i]);
+  TEST_CHECK(isEqual);
+
+    // Stream, that is held during dispatch, continues after transaction
+  TEST_CHECK(SPI::Write(stream, 4));
+  SPIModel::Step();
+  isHookArmed = true;
+  TEST_CHECK(SPI::Transaction<PinCS>({tx, 3}, {rx, 3}, _Callback));
+  TEST_CHECK(SPI::Write(stream + 4, 4));
+  SPIModel::Run();
+  TEST_CHECK(SPI::IsTxEmpty());
+  TEST_CHECK(SPI::GetRxCount() == sizeof(stream));
+  TEST_CHECK(countCallbacks == 2);
+  Memory::GetRegister(addressCCRTX).CallbackRead = nullptr;
+}
+
+static void TestFrame16(){
+  _Attach<SPI16>(_Invert);
+  SPI16::Init();
+  TEST_CHECK(Memory::Get(addressCR1) & (uint32_t)frame_size::FRAME_16_BIT);
+  const uint16_t tx[] = {0x1234, 0xABCD};
+  uint16_t rx[2] {};
+  TEST_CHECK(SPI16::Transaction({tx, 2}, {rx, 2}));
+  auto& statistics = SPIModel::Run();
+    // One DMA request per 16-bit frame
+  TEST_CHECK(statistics.frames == 2);
+  TEST_CHECK(rx[0] == 0xEDCB && rx[1] == 0x5432);
+}
+
+static void TestFrequency(){
+  using clock = Clock::Tree<>;
+  constexpr uint32_t maskBR = 7 << 3;
+  constexpr uint32_t clockSPI = clock::valueAPB2;
+  _Attach<SPI>();
+  SPI::Init<1000000>();
+  uint32_t cr1 = Memory::Get(addressCR1);
+  constexpr uint32_t frequency = SPI::GetFrequency<1000000>();
+  TEST_CHECK(frequency <= 1000000);
+  TEST_CHECK(2*frequency > 1000000 || (cr1 & maskBR) == maskBR);
+  TEST_CHECK(clockSPI >> (((cr1 & maskBR) >> 3) + 1) == frequency);
+    // Other bits of configuration are kept
+  TEST_CHECK(cr1 & (1 << 6));
+  SPI::SetFrequency<SPI_FREQUENCY_LIMIT * 4>();
+  cr1 = Memory::Get(addressCR1);
+  TEST_CHECK((clockSPI >> (((cr1 & maskBR) >> 3) + 1)) <= SPI_FREQUENCY_LIMIT);
+  TEST_CHECK((clockSPI >> (((cr1 & maskBR) >> 3) + 1)) == SPI::GetFrequency<SPI_FREQUENCY_LIMIT * 4>());
+  TEST_CHECK(cr1 & (1 << 6));
+}
+
+  // RCC: ready flags follow enable bits of HSI, HSE, PLL; switch status follows switch of system clock
+static void _AttachClock(){
+  constexpr uint32_t addressCR = 0x40021000;
+  constexpr uint32_t addressCFGR = 0x40021004;
+  Memory::Configure(addressCR).CallbackWrite = [](uint32_t address, uint32_t value){
+    Memory::Set(address, value | ((value & 0x1010001U) << 1));
+  };
+  Memory::Configure(addressCFGR).CallbackWrite = [](uint32_t address, uint32_t value){
+    Memory::Set(address, (value & ~0xCU) | ((value & 3U) << 2));
+  };
+}
+
+static void TestClock(){
+  using clock = Clock::Tree<36000000>;
+  constexpr uint32_t maskBR = 7 << 3;
+  _Attach<SPI>();
+  _AttachClock();
+    // Clock differs from Tree<>: tree with the same parameters is passed to SPI
+  TEST_CHECK(Clock::Set<36000000>());
+  TEST_CHECK(Clock::Get() == clock::valueSystem);
+  SPI::Init<1000000, clock>();
+  uint32_t cr1 = Memory::Get(addressCR1);
+  constexpr uint32_t frequency = SPI::GetFrequency<1000000, clock>();
+  TEST_CHECK(frequency <= 1000000 && 2*frequency > 1000000);
+  TEST_CHECK(clock::valueAPB2 >> (((cr1 & maskBR) >> 3) + 1) == frequency);
+    // APB2 is 36MHz: divisor 64, not 128 as for 72MHz
+  TEST_CHECK((cr1 & maskBR) == (5 << 3));
+}
+
+int main(){
+  TestStream();
+  TestTxInFlight();
+  TestTransaction();
+  TestTransactionQueue();
+  TestDummyAndSink();
+  TestTransactionDuringStream();
+  TestFrame16();
+  TestFrequency();
+  TestClock();
+  return test::Result("SPI_Test");
+}
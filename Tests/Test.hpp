@@ -0,0 +1,57 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Checks of host tests
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _TEST_HPP
+#define _TEST_HPP
+
+#include <cstddef>
+#include <cstdio>
+
+/*!
+  @brief Check condition of test. Failed check is printed, test continues
+*/
+#define TEST_CHECK(condition) test::Check((condition), #condition, __FILE__, __LINE__)
+
+/*!
+  @brief Host tests
+*/
+namespace test{
+
+inline size_t countChecks = 0;
+inline size_t countFailed = 0;
+
+/*!
+  @brief Check condition of test
+  @param [in] condition result of check
+  @param [in] expression text of condition
+  @param [in] file of check
+  @param [in] line of check
+  @return condition
+*/
+inline bool Check(bool condition, const char* expression, const char* file, int line){
+  countChecks++;
+  if (!condition){
+    countFailed++;
+    std::printf("%s:%d: check failed: %s\n", file, line, expression);
+  }
+  return condition;
+}
+
+/*!
+  @brief Print result of test
+  @param [in] name of test
+  @return exit code of test: 0 - all checks passed
+*/
+inline int Result(const char* name){
+  std::printf("%s: %zu checks, %zu failed\n", name, countChecks, countFailed);
+  return countFailed ? 1 : 0;
+}
+
+} // !namespace test
+
+#endif // !_TEST_HPP
@@ -0,0 +1,149 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Test of UART drivers on simulated multi-drop bus: 9-bit address mark and framer. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#define STM32F10X_MD
+#define REGISTERS_SIMULATION
+
+#include <cstdint>
+#include "../Controllers/UART/stm32f1_UART.hpp"
+#include "../Controllers/UART/stm32f1_UART_Bus_Simulation.hpp"
+#include "../Controllers/Interfaces/IFramer.hpp"
+#include "Test.hpp"
+
+using namespace controller;
+using namespace controller::configuration::uart;
+using controller::interfaces::IFramer;
+using controller::hardware::simulation::Memory;
+using controller::hardware::simulation::UARTBus;
+
+static constexpr uint32_t addressUART1 = 0x40013800;
+static constexpr uint32_t addressUART2 = 0x40004400;
+static constexpr uint32_t addressUART3 = 0x40004800;
+
+using Node1 = UART1<32, 32, communication::txISR_rxISR, mode::N_9_1>;
+using Node2 = UART2<32, 32, communication::txISR_rxISR, mode::N_9_1>;
+using Node3 = UART3<32, 32, communication::txISR_rxISR, mode::N_9_1>;
+
+  // Frame of node: element with address mark, data, delimiter
+static constexpr uint16_t delimiter = 0x0A;
+using Framer2 = IFramer<Node2, controller::interfaces::framing::Delimiter<delimiter>, 16>;
+
+static void _Attach(){
+  Memory::Clear();
+  UARTBus::Detach();
+  UARTBus::Attach(addressUART1, Node1::ISR);
+  UARTBus::Attach(addressUART2, Node2::ISR);
+  UARTBus::Attach(addressUART3, Node3::ISR);
+  Node1::Init<115200>();
+  Node2::Init<115200>();
+  Node3::Init<115200>();
+  Node2::EnableAddressMark<2>();
+  Node3::EnableAddressMark<3>();
+  Node1::FlushRX();
+  Node2::FlushRX();
+  Node3::FlushRX();
+}
+
+  // Transmitter via ISR: element is sent on each TXE interrupt
+template<typename node>
+static void _Flush(){
+  for (size_t i = 0; i < 64 && !node::IsTxEmpty(); ++i) node::ISR();
+}
+
+static void TestAddressMark(){
+  _Attach();
+  static_assert(std::is_same_v<Node2::type, uint16_t>, "9-bit data requires 16-bit elements");
+  TEST_CHECK(Node2::markAddress == 0x100);
+  TEST_CHECK(Node2::IsMuted() && Node3::IsMuted());
+
+  UARTBus::Transmit(Node2::markAddress | 2);
+  UARTBus::Transmit(0x11);
+  UARTBus::Transmit(0xFF);
+  TEST_CHECK(!Node2::IsMuted());
+  TEST_CHECK(Node3::IsMuted());
+  TEST_CHECK(Node2::GetRxCount() == 3);
+  TEST_CHECK(Node3::IsRxEmpty());
+  TEST_CHECK(Node2::Read() == (Node2::markAddress | 2));
+  TEST_CHECK(Node2::Read() == 0x11);
+  TEST_CHECK(Node2::Read() == 0xFF);
+
+    // Element with other address mutes receiver by hardware: no interrupts
+  auto node2 = UARTBus::GetNode(addressUART2);
+  size_t interrupts = node2->interrupts;
+  UARTBus::Transmit(Node3::markAddress | 3);
+  UARTBus::Transmit(0x33);
+  TEST_CHECK(Node2::IsMuted());
+  TEST_CHECK(node2->interrupts == interrupts);
+  TEST_CHECK(node2->muted == 2);
+  TEST_CHECK(Node3::GetRxCount() == 2);
+    // Node without address mark receives all
+  TEST_CHECK(Node1::GetRxCount() == 5);
+}
+
+static void TestNodeToNode(){
+  _Attach();
+  TEST_CHECK(Node1::WriteAddress(3));
+    // 9th bit is address mark, so data has 8 bits
+  const uint16_t data[] = {0x0A5, 0x05A};
+  TEST_CHECK(Node1::Write(data, 2));
+  _Flush<Node1>();
+  TEST_CHECK(Node1::IsTxEmpty());
+  TEST_CHECK(Node3::GetRxCount() == 3);
+  TEST_CHECK(Node2::IsRxEmpty());
+  TEST_CHECK(Node3::Read() == (Node3::markAddress | 3));
+  TEST_CHECK(Node3::Read() == 0x0A5);
+  TEST_CHECK(Node3::Read() == 0x05A);
+    // Node mutes itself at the end of frame
+  Node3::Mute();
+  UARTBus::Transmit(0x77);
+  TEST_CHECK(Node3::IsRxEmpty());
+}
+
+static size_t countFrames = 0;
+static uint16_t frameLast[4] {};
+
+static void TestFramer(){
+  _Attach();
+  UARTBus::Transmit(Node2::markAddress | 2);
+  UARTBus::Transmit(0x21);
+  UARTBus::Transmit(0x22);
+  UARTBus::Transmit(delimiter);
+  UARTBus::Transmit(Node3::markAddress | 3);
+  UARTBus::Transmit(0x31);
+  UARTBus::Transmit(delimiter);
+  TEST_CHECK(Framer2::Poll());
+  auto frame = Framer2::GetFrame();
+  TEST_CHECK(frame.GetSize() == 3);
+  if (frame.GetSize() == 3){
+    TEST_CHECK(frame[0] == (Node2::markAddress | 2));
+    TEST_CHECK(frame[2] == 0x22);
+  }
+  Framer2::Release();
+  TEST_CHECK(!Framer2::Poll());
+  TEST_CHECK(Node2::IsRxEmpty());
+
+    // Frames of node are extracted on rx event via callback. Bus doesn't model IDLE line, so event is raised by test
+  Framer2::Attach([](Framer2::frame_t frame){
+    countFrames++;
+    for (size_t i = 0; i < frame.GetSize() && i < 4; ++i) frameLast[i] = frame[i];
+  });
+  UARTBus::Transmit(Node2::markAddress | 2);
+  UARTBus::Transmit(0x44);
+  UARTBus::Transmit(delimiter);
+  Node2::CallbackRxNotEmpty();
+  TEST_CHECK(countFrames == 1);
+  TEST_CHECK(frameLast[1] == 0x44);
+  TEST_CHECK(Node2::IsRxEmpty());
+}
+
+int main(){
+  TestAddressMark();
+  TestNodeToNode();
+  TestFramer();
+  return test::Result("UART_Bus_Test");
+}
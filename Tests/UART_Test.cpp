@@ -0,0 +1,242 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Test of UART driver on simulated registers: tx buffer with DMA in flight, rx DMA events, DE guard. Host only
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#define STM32F10X_MD
+#define REGISTERS_SIMULATION
+
+#include <cstdint>
+#include "../Controllers/UART/stm32f1_UART.hpp"
+#include "Test.hpp"
+
+using namespace controller;
+using controller::hardware::simulation::Memory;
+
+using UART = UART1<64, 64>;
+
+  // DMA1 channel 4 is TX of UART1
+static constexpr uint32_t addressCCR = 0x40020008 + 20*3;
+static constexpr uint32_t addressCNDTR = addressCCR + 4;
+static constexpr uint32_t addressCMAR = addressCCR + 12;
+
+static bool _IsSending(const uint8_t* data, size_t size){
+  auto memory = static_cast<const uint8_t*>(Memory::GetPointer(Memory::Get(addressCMAR)));
+  if (!memory || !(Memory::Get(addressCCR) & 1) || Memory::Get(addressCNDTR) != size) return false;
+  for (size_t i = 0; i < size; ++i)
+    if (memory[i] != data[i]) return false;
+  return true;
+}
+
+  // Elements sent by DMA stay in tx buffer till transfer is complete, so write over them is dropped
+static void TestTxInFlight(){
+  Memory::Clear();
+  UART::Init<115200>();
+  uint8_t first[48];
+  uint8_t second[32];
+  for (size_t i = 0; i < sizeof(first); ++i) first[i] = static_cast<uint8_t>(i);
+  for (size_t i = 0; i < sizeof(second); ++i) second[i] = static_cast<uint8_t>(0x80 + i);
+
+  TEST_CHECK(UART::Write(first, sizeof(first)));
+  TEST_CHECK(_IsSending(first, sizeof(first)));
+  TEST_CHECK(UART::GetTxFree() == 64 - sizeof(first));
+    // Array, that doesn't fit, is dropped as a whole and reported
+  TEST_CHECK(!UART::Write(second, sizeof(second)));
+  TEST_CHECK(UART::GetTxDropped() == sizeof(second));
+  TEST_CHECK(UART::GetTxFree() == 64 - sizeof(first));
+  TEST_CHECK(_IsSending(first, sizeof(first)));
+
+  UART::FlushTX();
+  Memory::Clear();
+  UART::Init<115200>();
+  UART::ResetStatistics();
+  TEST_CHECK(UART::Write(first, sizeof(first)));
+  TEST_CHECK(UART::Write(second, 16));
+  TEST_CHECK(UART::GetTxCount() == 64);
+  TEST_CHECK(!UART::Write(second[16]));
+  TEST_CHECK(_IsSending(first, sizeof(first)));
+    // The rest is sent after transfer is complete
+  UART::ISR_DMA_TX();
+  TEST_CHECK(_IsSending(second, 16));
+  TEST_CHECK(UART::GetTxCount() == 16);
+  UART::ISR_DMA_TX();
+  TEST_CHECK(UART::IsTxEmpty());
+  TEST_CHECK(UART::GetTxDropped() == 1);
+}
+
+using UARTRX = UART1<64, 32>;
+
+  // DMA1 channel 5 is RX of UART1: circular transfer to rx buffer. Flags of events: TC - bit 17, HT - bit 18
+static constexpr uint32_t addressISR = 0x40020000;
+static constexpr uint32_t addressIFCR = 0x40020004;
+static constexpr uint32_t addressCNDTRRX = 0x40020008 + 20*4 + 4;
+static constexpr uint32_t addressCMARRX = 0x40020008 + 20*4 + 12;
+static constexpr uint32_t flagsRX = 3U << 17;
+static constexpr uint32_t flagTC = 1U << 17;
+static constexpr uint32_t flagHT = 1U << 18;
+
+static uint8_t valueRX = 0;
+static size_t countInCheck = 0;
+static size_t countErrors = 0;
+
+  // Elements are written at position of counter, counter is reloaded after the last one
+static void _Receive(size_t count){
+  auto memory = static_cast<uint8_t*>(Memory::GetPointer(Memory::Get(addressCMARRX)));
+  uint32_t cndtr = Memory::Get(addressCNDTRRX);
+  uint32_t flags = 0;
+  for (size_t i = 0; i < count; ++i){
+    memory[32 - cndtr] = valueRX++;
+    if (--cndtr == 16) flags |= flagHT;
+    if (!cndtr){
+      flags |= flagTC;
+      cndtr = 32;
+    }
+  }
+  Memory::Set(addressCNDTRRX, cndtr);
+  if (flags) Memory::Set(addressISR, Memory::Get(addressISR) | flags | (1U << 16));
+}
+
+  // Flags are cleared by writing 1. DMA receives elements right after the clear, if it is armed by test
+static void _WriteIFCR(uint32_t, uint32_t value){
+  Memory::Set(addressISR, Memory::Get(addressISR) & ~value);
+  size_t count = countInCheck;
+  countInCheck = 0;
+  if (count) _Receive(count);
+}
+
+static bool _ReadRX(size_t count, uint8_t first){
+  if (UARTRX::GetRxCount() != count) return false;
+  bool isEqual = true;
+  for (size_t i = 0; i < count; ++i) isEqual &= UARTRX::Read() == static_cast<uint8_t>(first + i);
+  return isEqual;
+}
+
+  // Tail of rx buffer is moved by half transfer and transfer complete events
+static void TestRxDMA(){
+  Memory::Clear();
+  UARTRX::Init<115200>();
+  Memory::Configure(addressIFCR).CallbackWrite = _WriteIFCR;
+  UARTRX::CallbackError = [](){ countErrors++; };
+  TEST_CHECK(Memory::Get(addressCNDTRRX) == 32);
+
+  _Receive(16);
+  UARTRX::ISR_DMA_RX();
+  TEST_CHECK(!(Memory::Get(addressISR) & flagsRX));
+  TEST_CHECK(_ReadRX(16, 0));
+  _Receive(16);
+  UARTRX::ISR_DMA_RX();
+  TEST_CHECK(!(Memory::Get(addressISR) & flagsRX));
+  TEST_CHECK(_ReadRX(16, 16));
+    // Elements before IDLE are taken by counter without flags
+  _Receive(20);
+  UARTRX::ISR_DMA_RX();
+  TEST_CHECK(_ReadRX(20, 32));
+
+    // DMA wraps, while flags are cleared: wrap is counted once by the next interrupt
+  _Receive(6);
+  countInCheck = 10;
+  UARTRX::ISR_DMA_RX();
+  TEST_CHECK(UARTRX::GetRxCount() == 6);
+  TEST_CHECK(Memory::Get(addressISR) & flagTC);
+  UARTRX::ISR_DMA_RX();
+  TEST_CHECK(!(Memory::Get(addressISR) & flagsRX));
+  TEST_CHECK(_ReadRX(16, 52));
+  TEST_CHECK(!UARTRX::GetErrors().overflow);
+  TEST_CHECK(countErrors == 0);
+  UARTRX::ISR_DMA_RX();
+  TEST_CHECK(UARTRX::IsRxEmpty());
+
+    // DMA laps unread data
+  _Receive(8);
+  UARTRX::ISR_DMA_RX();
+  _Receive(30);
+  UARTRX::ISR_DMA_RX();
+  TEST_CHECK(UARTRX::GetErrors().overflow);
+  TEST_CHECK(countErrors == 1);
+  TEST_CHECK(UARTRX::GetRxCount() == 32);
+  UARTRX::CallbackError = nullptr;
+}
+
+  // Driver enable of RS-485: idle frame is counted, when TE is written from 0 to 1
+struct PinDE{
+  static inline bool isHigh = false;
+  static void High(){ isHigh = true; }
+  static void Low(){ isHigh = false; }
+};
+
+static constexpr uint32_t addressSR = 0x40013800;
+static constexpr uint32_t addressCR1 = addressSR + 12;
+static constexpr uint32_t flagTXE = 1U << 7;
+static constexpr uint32_t flagTCUART = 1U << 6;
+static constexpr uint32_t flagTE = 1U << 3;
+static constexpr uint32_t flagTCIE = 1U << 6;
+static size_t countIdle = 0;
+
+static void _AttachDE(){
+  Memory::Clear();
+  countIdle = 0;
+  Memory::Configure(addressCR1).CallbackWrite = [](uint32_t, uint32_t value){
+    static bool isTE = true;
+    if (!isTE && (value & flagTE)) countIdle++;
+    isTE = value & flagTE;
+  };
+}
+
+  // Guard of 12 bits is 2 idle frames of 10 bits: DE is released by the third TC, ISR doesn't wait
+template<typename uart>
+static void _CheckGuardDE(){
+  countIdle = 0;
+  for (size_t i = 0; i < 2; ++i){
+    Memory::Set(addressSR, flagTXE | flagTCUART);
+    uart::ISR();
+    TEST_CHECK(PinDE::isHigh);
+    TEST_CHECK(countIdle == i + 1);
+  }
+  Memory::Set(addressSR, flagTXE | flagTCUART);
+  uart::ISR();
+  TEST_CHECK(!PinDE::isHigh);
+  TEST_CHECK(countIdle == 2);
+  TEST_CHECK(Memory::Get(addressCR1) & flagTE);
+}
+
+using UARTDE = UART1<16, 16, configuration::uart::communication::txISR_rxISR, configuration::uart::mode::N_8_1,
+                     configuration::uart::remap::None, PinDE, 12>;
+using UARTDEDMA = UART1<16, 16, configuration::uart::communication::txDMA_rxDMA, configuration::uart::mode::N_8_1,
+                        configuration::uart::remap::None, PinDE, 12>;
+
+static void TestGuardDE(){
+  _AttachDE();
+  UARTDE::Init<115200>();
+  TEST_CHECK(UARTDE::Write(0x55));
+  TEST_CHECK(PinDE::isHigh);
+  Memory::Set(addressSR, flagTXE);
+  UARTDE::ISR();
+  Memory::Set(addressSR, flagTXE | flagTCUART);
+  UARTDE::ISR();
+  TEST_CHECK(countIdle == 1);
+    // Write during guard: DE is kept, guard starts again after the last element
+  TEST_CHECK(UARTDE::Write(0x56));
+  Memory::Set(addressSR, flagTXE);
+  UARTDE::ISR();
+  TEST_CHECK(PinDE::isHigh);
+  _CheckGuardDE<UARTDE>();
+  TEST_CHECK(!(Memory::Get(addressCR1) & flagTCIE));
+
+  _AttachDE();
+  UARTDEDMA::Init<115200>();
+  TEST_CHECK(UARTDEDMA::Write(0x55));
+  TEST_CHECK(PinDE::isHigh);
+  UARTDEDMA::ISR_DMA_TX();
+  TEST_CHECK(PinDE::isHigh);
+  _CheckGuardDE<UARTDEDMA>();
+}
+
+int main(){
+  TestTxInFlight();
+  TestRxDMA();
+  TestGuardDE();
+  return test::Result("UART_Test");
+}
@@ -0,0 +1,149 @@
+//----------------------------------------------------------------------------------
+//  Author:       Semyon Ivanov
+//  e-mail:       agreement90@mail.ru
+//  github:       https://github.com/7bnx/Embedded
+//  Description:  Coroutine task with static frame allocator
+//  TODO:
+//----------------------------------------------------------------------------------
+
+#ifndef _COROUTINE_HPP
+#define _COROUTINE_HPP
+
+#if defined(__cpp_impl_coroutine)
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+
+#ifndef COROUTINE_FRAME_SIZE
+  #define COROUTINE_FRAME_SIZE 256
+#endif
+
+#ifndef COROUTINE_FRAMES
+  #define COROUTINE_FRAMES 4
+#endif
+
+/*!
+  @file
+  @brief Coroutine task with static frame allocator. Requires C++20
+*/
+
+/*!
+  @brief Namespace for coroutines utils
+*/
+namespace utils::coroutine{
+
+/*!
+  @brief Pool of coroutine frames with static storage. No heap is used.
+    Allocation and release are lock-free, so coroutine may be started and finished in ISR
+  @tparam <sizeFrame> max size of frame in bytes
+  @tparam <countFrames> number of frames. Not more than 32
+*/
+template<size_t sizeFrame, size_t countFrames>
+class FramePool{
+
+  static_assert(countFrames && countFrames <= 32, "Number of frames should be in range [1, 32]");
+
+public:
+
+  FramePool() = delete;
+
+  /*!
+    @brief Allocate frame
+    @param [in] size of frame
+    @return pointer to frame. nullptr, if size is too big or no free frame
+  */
+  static void* Allocate(size_t size) noexcept {
+    if (size > sizeFrame) return nullptr;
+    uint32_t current = used.load(std::memory_order_relaxed);
+    while (current != maskAll){
+      uint32_t index = __builtin_ctz(~current);
+      if (used.compare_exchange_weak(current, current | (1U << index), std::memory_order_acquire))
+        return frames[index];
+    }
+    return nullptr;
+  }
+
+  /*!
+    @brief Release frame
+    @param [in] frame pointer to frame
+  */
+  static void Free(void* frame) noexcept {
+    size_t index = (static_cast<uint8_t*>(frame) - frames[0]) / sizeFrame;
+    used.fetch_and(~(1U << index), std::memory_order_release);
+  }
+
+  /*!
+    @brief Get number of allocated frames
+  */
+  static size_t GetUsed() noexcept { return __builtin_popcount(used.load(std::memory_order_relaxed)); }
+
+  /*!
+    @brief Get max size of frame
+  */
+  static constexpr size_t GetFrameSize() noexcept { return sizeFrame; }
+
+private:
+
+  static constexpr uint32_t maskAll = countFrames == 32 ? ~0U : (1U << countFrames) - 1;
+
+  static inline std::atomic<uint32_t> used = 0;
+  alignas(std::max_align_t) static inline uint8_t frames[countFrames][sizeFrame] {};
+
+};
+
+/*!
+  @brief Default pool: COROUTINE_FRAMES frames of COROUTINE_FRAME_SIZE bytes
+*/
+using Frames = FramePool<COROUTINE_FRAME_SIZE, COROUTINE_FRAMES>;
+
+/*!
+  @brief Detached coroutine, e.g.: sequence of device driver.
+    Starts at once, runs till first suspension and continues in context of resumer(e.g. ISR).
+    Frame is allocated from Frames and released after completion
+*/
+class Task{
+
+public:
+
+  struct promise_type{
+
+    static void* operator new(size_t size) noexcept { return Frames::Allocate(size); }
+
+    static void operator delete(void* frame) noexcept { Frames::Free(frame); }
+
+    static Task get_return_object_on_allocation_failure() noexcept { return Task{false}; }
+
+    Task get_return_object() noexcept { return Task{true}; }
+
+    std::suspend_never initial_suspend() noexcept { return {}; }
+
+    std::suspend_never final_suspend() noexcept { return {}; }
+
+    void return_void() noexcept {}
+
+    void unhandled_exception() noexcept { std::terminate(); }
+
+  };
+
+  /*!
+    @brief Check the start of coroutine
+    @return false, if there is no free frame
+  */
+  explicit operator bool() const { return isStarted; }
+
+private:
+
+  explicit Task(bool isStarted): isStarted(isStarted){}
+
+  bool isStarted;
+
+};
+
+} // !namespace utils::coroutine
+
+#endif // !__cpp_impl_coroutine
+
+#endif // !_COROUTINE_HPP
@@ -6,8 +6,8 @@
 //  TODO:
 //----------------------------------------------------------------------------------
 
-#ifndef _TIME_H
-#define _TIME_H
+#ifndef _TIME_HPP
+#define _TIME_HPP
 
 #include <cstddef>
 #include <cstdint>
@@ -360,4 +360,4 @@ private:
 
 } // namespace utils
 
-#endif // !_TIME_H
\ No newline at end of file
+#endif // !_TIME_HPP
\ No newline at end of file